@@ -0,0 +1,274 @@
+#include "loop.h"
+#include "timer.h"
+#include "job.h"
+#include "memory.h"
+#include "log.h"
+#include "audio_format.h"
+#include "display.h"
+
+// Runs each benchmark from loop_init, logs the results and exits.
+
+#define BENCHMARK_SPRITES (256 * KIBI)
+#define BENCHMARK_SPRITE_RUNS 16
+
+#define BENCHMARK_REDUCE_LENGTH (16 * MEBI)
+#define BENCHMARK_REDUCE_RUNS 16
+
+#define BENCHMARK_HEAP_LENGTH MEBI
+#define BENCHMARK_HEAP_RUNS 4
+
+// The same heap at three arities, told apart by element type name.
+typedef U64 BinaryKey;
+typedef U64 QuaternaryKey;
+typedef U64 OctonaryKey;
+
+#define HEAP_ELEMENT BinaryKey
+#define HEAP_ARITY 2
+#include "generic/heap.h"
+
+#define HEAP_ELEMENT QuaternaryKey
+#define HEAP_ARITY 4
+#include "generic/heap.h"
+
+#define HEAP_ELEMENT OctonaryKey
+#define HEAP_ARITY 8
+#include "generic/heap.h"
+
+static S64 frequency = 0;
+
+static F64 benchmark_ms(S64 start, S64 end)
+{
+  return 1000.0 * (F64) (end - start) / (F64) frequency;
+}
+
+/*******************************************************************************
+ * PARALLEL LOOPS
+ ******************************************************************************/
+
+typedef Void BenchmarkFunction(Void* data);
+
+// Times the function at every thread count from one to one per core,
+// restarting the job system for each, and logs the speedup over one thread.
+static Void benchmark_scaling(const Char* name, BenchmarkFunction* function, Void* data, S32 runs)
+{
+  F64 serial = 0.0;
+  const S32 cores = platform_core_count();
+  for (S32 threads = 1; threads <= cores; threads++) {
+    job_terminate();
+    job_init(threads == 1 ? -1 : threads - 1, 0, false);
+
+    // warm up the workers and the caches
+    function(data);
+
+    const S64 start = timer_get_counter();
+    for (S32 run = 0; run < runs; run++) {
+      function(data);
+    }
+    const F64 ms = benchmark_ms(start, timer_get_counter()) / runs;
+    if (threads == 1) {
+      serial = ms;
+    }
+    platform_log_info("%s: %2d threads %8.3f ms %5.2fx", name, threads, ms, serial / ms);
+  }
+}
+
+typedef struct SpriteTransform {
+  const Sprite* source;
+  Sprite* target;
+  F32 time;
+} SpriteTransform;
+
+// Spins each sprite about the origin, pulses its size and scrolls its
+// texture, as a particle update would.
+static Void benchmark_transform_range(Index begin, Index end, Void* user)
+{
+  const SpriteTransform* const transform = user;
+  const V2F scroll = v2f(transform->time, 0.f);
+  for (Index i = begin; i < end; i++) {
+    const Sprite* const in = &transform->source[i];
+    const F32 angle = transform->time + 0.001f * (F32) i;
+    const F32 c = f32_cos(angle);
+    const F32 s = f32_sin(angle);
+    Sprite out = *in;
+    out.root = v2f(c * in->root.x - s * in->root.y, s * in->root.x + c * in->root.y);
+    out.size = v2f_scale(in->size, 1.f + 0.5f * s);
+    out.ta = v2f_add(in->ta, scroll);
+    out.tb = v2f_add(in->tb, scroll);
+    transform->target[i] = out;
+  }
+}
+
+static Void benchmark_transform(Void* data)
+{
+  SpriteTransform* const transform = data;
+  transform->time += 1.f / 60.f;
+  platform_parallel_for(0, BENCHMARK_SPRITES, 0, benchmark_transform_range, transform);
+}
+
+static Void benchmark_sprites()
+{
+  Sprite* const sprites = platform_virtual_alloc(2 * BENCHMARK_SPRITES * sizeof(Sprite));
+  if (sprites == NULL) {
+    platform_log_error("failed to allocate benchmark data");
+    return;
+  }
+  for (Index i = 0; i < BENCHMARK_SPRITES; i++) {
+    Sprite* const sprite = &sprites[i];
+    sprite->root = v2f((F32) (i % 1024), (F32) (i / 1024));
+    sprite->size = v2f(1.f, 1.f);
+    sprite->color = COLOR_WHITE;
+    sprite->ta = v2f(0.f, 0.f);
+    sprite->tb = v2f(1.f, 1.f);
+  }
+
+  SpriteTransform transform = { sprites, sprites + BENCHMARK_SPRITES, 0.f };
+  benchmark_scaling("sprites", benchmark_transform, &transform, BENCHMARK_SPRITE_RUNS);
+  platform_virtual_free(sprites);
+}
+
+static Void benchmark_sum(Index begin, Index end, Void* accumulator, Void* user)
+{
+  const U32* const data = user;
+  U64 sum = *(U64*) accumulator;
+  for (Index i = begin; i < end; i++) {
+    sum += data[i] * data[i];
+  }
+  *(U64*) accumulator = sum;
+}
+
+static Void benchmark_combine(Void* accumulator, const Void* other, Void* user)
+{
+  UNUSED_PARAMETER(user);
+  *(U64*) accumulator += *(const U64*) other;
+}
+
+static Void benchmark_sum_of_squares(Void* data)
+{
+  U64 sum = 0;
+  platform_parallel_reduce(
+      0, BENCHMARK_REDUCE_LENGTH, 0, &sum, sizeof(sum), benchmark_sum, benchmark_combine, data);
+}
+
+// Sum of squares, which is bound by memory bandwidth rather than arithmetic.
+static Void benchmark_reduce()
+{
+  U32* const data = platform_virtual_alloc(BENCHMARK_REDUCE_LENGTH * sizeof(U32));
+  if (data == NULL) {
+    platform_log_error("failed to allocate benchmark data");
+    return;
+  }
+  for (Index i = 0; i < BENCHMARK_REDUCE_LENGTH; i++) {
+    data[i] = (U32) (i * 0x9E3779B9u) >> 16;
+  }
+  benchmark_scaling("reduce", benchmark_sum_of_squares, data, BENCHMARK_REDUCE_RUNS);
+  platform_virtual_free(data);
+}
+
+/*******************************************************************************
+ * HEAP
+ ******************************************************************************/
+
+static U64 benchmark_random(U64* state)
+{
+  // xorshift64
+  U64 x = *state;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  *state = x;
+  return x;
+}
+
+// Fills the heap, then runs it as a timer queue would, popping the least key
+// and pushing a later one, then drains it. Returns the milliseconds per run.
+#define BENCHMARK_HEAP(T)                                                        \
+  static F64 benchmark_heap_##T(T* buffer)                                       \
+  {                                                                              \
+    U64 check = 0;                                                               \
+    const S64 start = timer_get_counter();                                       \
+    for (S32 run = 0; run < BENCHMARK_HEAP_RUNS; run++) {                        \
+      Heap##T heap;                                                              \
+      heap_init_##T(&heap, buffer, BENCHMARK_HEAP_LENGTH);                       \
+      U64 random = 0x9E3779B97F4A7C15u;                                          \
+      for (Index i = 0; i < BENCHMARK_HEAP_LENGTH; i++) {                        \
+        heap_push_##T(&heap, benchmark_random(&random) >> 16);                   \
+      }                                                                          \
+      for (Index i = 0; i < BENCHMARK_HEAP_LENGTH; i++) {                        \
+        const U64 least = heap_pop_##T(&heap, 0);                                \
+        heap_push_##T(&heap, least + (benchmark_random(&random) >> 40));         \
+      }                                                                          \
+      while (heap_size_##T(&heap) > 0) {                                         \
+        check += heap_pop_##T(&heap, 0);                                         \
+      }                                                                          \
+    }                                                                            \
+    const F64 ms = benchmark_ms(start, timer_get_counter()) / BENCHMARK_HEAP_RUNS; \
+    platform_log_debug("heap checksum %llu", (unsigned long long) check);        \
+    return ms;                                                                   \
+  }
+
+BENCHMARK_HEAP(BinaryKey)
+BENCHMARK_HEAP(QuaternaryKey)
+BENCHMARK_HEAP(OctonaryKey)
+
+// The default arity against a binary heap. The 8 MiB of keys stays in the
+// last level cache of most desktop parts, so this measures the in-cache case.
+static Void benchmark_heap()
+{
+  U64* const buffer = platform_virtual_alloc(BENCHMARK_HEAP_LENGTH * sizeof(U64));
+  if (buffer == NULL) {
+    platform_log_error("failed to allocate benchmark data");
+    return;
+  }
+  const F64 binary = benchmark_heap_BinaryKey(buffer);
+  const F64 quaternary = benchmark_heap_QuaternaryKey(buffer);
+  const F64 octonary = benchmark_heap_OctonaryKey(buffer);
+  platform_log_info("heap: arity 2 %8.3f ms 1.00x", binary);
+  platform_log_info("heap: arity 4 %8.3f ms %5.2fx", quaternary, binary / quaternary);
+  platform_log_info("heap: arity 8 %8.3f ms %5.2fx", octonary, binary / octonary);
+  platform_virtual_free(buffer);
+}
+
+/*******************************************************************************
+ * LOOP
+ ******************************************************************************/
+
+ProgramStatus loop_config(ProgramConfig* config, const SystemInfo* system)
+{
+  UNUSED_PARAMETER(system);
+  config->resolution = v2s(320, 180);
+  config->title = "Benchmark";
+  config->caption = "Benchmark";
+  return PROGRAM_STATUS_LIVE;
+}
+
+ProgramStatus loop_init()
+{
+  timer_init();
+  frequency = timer_get_frequency();
+  benchmark_sprites();
+  benchmark_reduce();
+  benchmark_heap();
+  return PROGRAM_STATUS_SUCCESS;
+}
+
+Void loop_event(const Event* event)
+{
+  UNUSED_PARAMETER(event);
+}
+
+ProgramStatus loop_video()
+{
+  return PROGRAM_STATUS_SUCCESS;
+}
+
+ProgramStatus loop_audio(F32* out, Index frames)
+{
+  for (Index i = 0; i < STEREO * frames; i++) {
+    out[i] = 0.f;
+  }
+  return PROGRAM_STATUS_LIVE;
+}
+
+Void loop_terminate()
+{
+}
@@ -14,7 +14,7 @@ static V2S window_resolution = { 960, 540 };
 
 static S64 frequency = 0;
 static S64 frame = 0;
-static TextureID texture_white = 0;
+static TextureID texture_white = {0};
 
 ProgramStatus loop_config(ProgramConfig* config, const SystemInfo* system)
 {
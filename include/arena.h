@@ -0,0 +1,84 @@
+/*******************************************************************************
+ * arena.h - linear allocator
+ *
+ * An arena reserves a large range of address space up front and commits pages
+ * lazily as the allocation cursor advances. Individual allocations are never
+ * freed. Instead, the cursor is rewound to a previously taken mark, or reset
+ * to the beginning. Committed pages are retained across rewinds and resets.
+ ******************************************************************************/
+
+#pragma once
+
+#include "prelude.h"
+#include "memory.h"
+
+// Pages are committed in multiples of this size, to amortize the cost of the
+// underlying system call.
+#ifndef ARENA_COMMIT_GRANULARITY
+#define ARENA_COMMIT_GRANULARITY (64 * KIBI)
+#endif
+
+#define ARENA_DEFAULT_ALIGNMENT 16
+
+#define ARENA_PUSH(arena, T) \
+  ((T*) arena_alloc_aligned((arena), sizeof(T), _Alignof(T)))
+#define ARENA_PUSH_ARRAY(arena, T, count) \
+  ((T*) arena_alloc_aligned((arena), sizeof(T) * (count), _Alignof(T)))
+
+typedef struct Arena {
+  Byte* base;         // start of the reserved range
+  Index reserved;     // bytes of address space reserved
+  Index committed;    // bytes of address space committed
+  Index position;     // allocation cursor
+  MemoryTag tag;      // tag for memory accounting
+} Arena;
+
+typedef Index ArenaMark;
+
+// Reserves address space for the arena. No memory is committed until the
+// first allocation. Untagged arenas are not counted.
+Void arena_init(Arena* arena, Index reserve);
+Void arena_init_tagged(Arena* arena, Index reserve, MemoryTag tag);
+Void arena_release(Arena* arena);
+
+// Ensures that the first `size` bytes of the arena are committed. Returns
+// false if this would exceed the reservation, or the system refuses.
+Bool arena_commit(Arena* arena, Index size);
+
+// Returns committed pages beyond the cursor to the system, keeping the
+// reservation. Useful after a rewind or reset that freed a lot of memory.
+Void arena_decommit(Arena* arena);
+
+// Returns NULL when the reservation is exhausted.
+static inline Void* arena_alloc_aligned(Arena* arena, Index size, Index alignment)
+{
+  ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0);
+  const Index start = (arena->position + alignment - 1) & ~(alignment - 1);
+  const Index end = start + size;
+  if (end > arena->committed && arena_commit(arena, end) == false) {
+    return NULL;
+  }
+  arena->position = end;
+  return arena->base + start;
+}
+
+static inline Void* arena_alloc(Arena* arena, Index size)
+{
+  return arena_alloc_aligned(arena, size, ARENA_DEFAULT_ALIGNMENT);
+}
+
+static inline ArenaMark arena_mark(const Arena* arena)
+{
+  return arena->position;
+}
+
+static inline Void arena_rewind(Arena* arena, ArenaMark mark)
+{
+  ASSERT(mark <= arena->position);
+  arena->position = mark;
+}
+
+static inline Void arena_reset(Arena* arena)
+{
+  arena->position = 0;
+}
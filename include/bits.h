@@ -0,0 +1,68 @@
+/*******************************************************************************
+ * bits.h - bit manipulation
+ ******************************************************************************/
+
+#pragma once
+
+#include "prelude.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// The scan functions are undefined for zero.
+
+static inline S32 bits_ctz32(U32 x)
+{
+  ASSERT(x != 0);
+#ifdef _MSC_VER
+  unsigned long index = 0;
+  _BitScanForward(&index, x);
+  return (S32) index;
+#else
+  return __builtin_ctz(x);
+#endif
+}
+
+static inline S32 bits_ctz64(U64 x)
+{
+  ASSERT(x != 0);
+#ifdef _MSC_VER
+  unsigned long index = 0;
+  _BitScanForward64(&index, x);
+  return (S32) index;
+#else
+  return __builtin_ctzll(x);
+#endif
+}
+
+static inline S32 bits_clz64(U64 x)
+{
+  ASSERT(x != 0);
+#ifdef _MSC_VER
+  unsigned long index = 0;
+  _BitScanReverse64(&index, x);
+  return 63 - (S32) index;
+#else
+  return __builtin_clzll(x);
+#endif
+}
+
+// Written out, since the MSVC intrinsic requires the POPCNT instruction.
+static inline S32 bits_popcount64(U64 x)
+{
+#ifdef _MSC_VER
+  x = x - ((x >> 1) & 0x5555555555555555ull);
+  x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+  x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+  return (S32) ((x * 0x0101010101010101ull) >> 56);
+#else
+  return __builtin_popcountll(x);
+#endif
+}
+
+// Smallest power of two greater than or equal to x, for x > 0.
+static inline U64 bits_ceil_pow2(U64 x)
+{
+  return x <= 1 ? 1 : (U64) 1 << (64 - bits_clz64(x - 1));
+}
@@ -0,0 +1,68 @@
+/*******************************************************************************
+ * block_allocator.h - real-time safe allocator
+ *
+ * Hands out blocks in a fixed set of power-of-two size classes, carved from a
+ * region allocated up front. Each thread allocates through its own cache.
+ * Allocating and freeing on the owning thread never locks or calls into the
+ * system, and is wait-free except when claiming a new slab, which retries a
+ * compare-and-swap only while other caches are claiming at the same time. A
+ * block freed on another thread is pushed onto a lock-free list belonging to
+ * its owner, who collects the whole list with a single atomic exchange.
+ *
+ * This makes it suitable for the audio thread, with the main thread free to
+ * release audio objects at any time.
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdatomic.h>
+#include "prelude.h"
+
+// The smallest class holds BLOCK_MINIMUM bytes, and each class is twice the
+// size of the one before. The defaults give classes from 16 bytes to 4 KiB.
+#define BLOCK_MINIMUM 16
+
+#ifndef BLOCK_CLASSES
+#define BLOCK_CLASSES 9
+#endif
+
+// Caches claim memory from the region in slabs of this size.
+#ifndef BLOCK_SLAB
+#define BLOCK_SLAB (64 * KIBI)
+#endif
+
+typedef struct BlockHeader BlockHeader;
+
+typedef struct BlockAllocator {
+  Byte* base;
+  Index size;
+  _Atomic Index cursor;
+} BlockAllocator;
+
+typedef struct BlockCache {
+
+  BlockAllocator* allocator;
+
+  // owner thread only
+  BlockHeader* local[BLOCK_CLASSES];
+  Byte* cursor;
+  Byte* limit;
+
+  // blocks returned by other threads
+  _Alignas(CACHE_LINE) _Atomic(BlockHeader*) remote[BLOCK_CLASSES];
+
+} BlockCache;
+
+// The allocator does not take ownership of the memory. Locked memory from
+// platform_locked_alloc is a good fit for real-time use.
+Void block_allocator_init(BlockAllocator* allocator, Void* memory, Index size);
+
+// Caches must outlive any block allocated through them.
+Void block_cache_init(BlockCache* cache, BlockAllocator* allocator);
+
+// Returns NULL if the size exceeds the largest class, or the region is
+// exhausted. Blocks are 16-byte aligned, given a 16-byte aligned region.
+Void* block_alloc(BlockCache* cache, Index size);
+
+// `cache` is the calling thread's cache, or NULL if it has none.
+Void block_free(BlockCache* cache, Void* pointer);
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "linear_algebra.h"
+#include "generic/slot_map.h"
 
 #define COLOR_WHITE     0xFFFFFFFF
 #define COLOR_BLACK     0xFF000000
@@ -12,7 +13,10 @@
 #define COLOR_GREEN     0xFF00FF00
 #define COLOR_BLUE      0xFFFF0000
 
-typedef U32 TextureID;
+// A zeroed TextureID never refers to a texture.
+typedef SlotHandle TextureID;
+
+typedef struct DisplayList DisplayList;
 
 typedef struct {
   V2F ta;
@@ -31,6 +35,10 @@ U32 display_color_lerp(U32 a, U32 b, F32 t);
 
 // The image is expected to be in 4-channel interleaved format.
 TextureID display_load_image(const Byte* image, V2S dimensions);
+Void display_unload_image(TextureID texture);
+
+// Returns zero for a stale ID.
+V2S display_texture_size(TextureID texture);
 
 Void display_begin_frame();
 Void display_end_frame();
@@ -42,3 +50,18 @@ Void display_draw_sprite(V2F root, V2F size, U32 color, V2F t1, V2F t2);
 Void display_draw_sprite_struct(Sprite sprite);
 Void display_draw_texture(V2F root, V2F size, U32 color);
 Void display_draw_texture_struct(Sprite sprite);
+
+// Command lists let one thread build a frame while another submits the last
+// one. While a list is being recorded, the frame and drawing calls above
+// append to it instead of calling GL, and need no GL context. Submitting
+// replays the list, and must happen on the thread that owns the context.
+// Textures are loaded and unloaded immediately, so that also must happen on
+// the context's thread, and not while a list that uses them is in flight.
+DisplayList* display_list_create();
+Void display_list_destroy(DisplayList* list);
+
+// Starts recording the calling thread's drawing into the list, discarding
+// what it held. NULL stops recording. Other threads are unaffected, and
+// each list should be recorded by only one thread at a time.
+Void display_record(DisplayList* list);
+Void display_submit(const DisplayList* list);
@@ -0,0 +1,33 @@
+/*******************************************************************************
+ * fiber.h - cooperative user-mode threads
+ *
+ * A fiber is a stack and a saved register context. Switching fibers swaps the
+ * context without entering the scheduler, so a thread can set aside work that
+ * is waiting and run something else. A fiber may be resumed on a different
+ * thread from the one it was suspended on.
+ *
+ * Fibers are backed by Win32 fibers on Windows and ucontext on Linux.
+ ******************************************************************************/
+
+#pragma once
+
+#include "prelude.h"
+
+typedef struct Fiber Fiber;
+
+// The entry point must never return. It should switch to another fiber
+// instead, and be destroyed from there.
+typedef Void FiberEntry(Void* data);
+
+// Makes the calling thread's own context into a fiber, so it can switch to
+// others and be switched back to. Returns NULL on failure.
+Fiber* platform_fiber_enter();
+Void platform_fiber_leave(Fiber* thread_fiber);
+
+// Returns NULL on failure.
+Fiber* platform_fiber_create(Index stack_size, FiberEntry* entry, Void* data);
+Void platform_fiber_destroy(Fiber* fiber);
+
+// Saves the current context into `from`, which must be the running fiber, and
+// resumes `to`.
+Void platform_fiber_switch(Fiber* from, Fiber* to);
@@ -0,0 +1,155 @@
+/*******************************************************************************
+ * GENERIC ARRAY
+ *
+ * The user should define ARRAY_ELEMENT as the type parameter.
+ *
+ * A growable array which reserves address space for its maximum length up
+ * front, and commits pages as it grows. Growing never moves the elements, so
+ * pointers into the array stay valid for its whole lifetime. Operations that
+ * add elements return false only when the reservation is exhausted.
+ ******************************************************************************/
+
+#ifndef GENERIC_ARRAY_H
+#define GENERIC_ARRAY_H
+
+#include <string.h>
+#include "prelude.h"
+#include "memory.h"
+
+#ifndef ARRAY_COMMIT_GRANULARITY
+#define ARRAY_COMMIT_GRANULARITY (64 * KIBI)
+#endif
+
+#define ARRAY_CAT(a, ...) ARRAY_CAT_(a, __VA_ARGS__)
+#define ARRAY_CAT_(a, ...) a##__VA_ARGS__
+#define ARRAY_TYPE(T) ARRAY_CAT(Array, T)
+#define ARRAY_CREATE(T) ARRAY_CAT(array_create_, T)
+#define ARRAY_DESTROY(T) ARRAY_CAT(array_destroy_, T)
+#define ARRAY_RESERVE(T) ARRAY_CAT(array_reserve_, T)
+#define ARRAY_PUSH(T) ARRAY_CAT(array_push_, T)
+#define ARRAY_POP(T) ARRAY_CAT(array_pop_, T)
+#define ARRAY_INSERT(T) ARRAY_CAT(array_insert_, T)
+#define ARRAY_REMOVE_SWAP(T) ARRAY_CAT(array_remove_swap_, T)
+#define ARRAY_APPEND(T) ARRAY_CAT(array_append_, T)
+#define ARRAY_CLEAR(T) ARRAY_CAT(array_clear_, T)
+
+#endif
+
+typedef struct
+{
+  ARRAY_ELEMENT* data;
+  Index length;     // live elements
+  Index capacity;   // elements that fit in committed memory
+  Index maximum;    // elements that fit in the reservation
+  Index committed;  // bytes committed
+  Index reserved;   // bytes reserved
+} ARRAY_TYPE(ARRAY_ELEMENT);
+
+// Reservations and commits are untagged, so they are not counted.
+static inline Void ARRAY_CREATE(ARRAY_ELEMENT)(ARRAY_TYPE(ARRAY_ELEMENT) * array, Index maximum)
+{
+  const Index g = ARRAY_COMMIT_GRANULARITY;
+  const Index bytes = maximum * (Index) sizeof(ARRAY_ELEMENT);
+  array->reserved = (bytes + g - 1) / g * g;
+  array->data = platform_virtual_reserve_tagged((Size) array->reserved, MEMORY_TAG_NONE);
+  if (array->data == NULL) {
+    array->reserved = 0;
+  }
+  array->maximum = array->reserved / (Index) sizeof(ARRAY_ELEMENT);
+  array->length = 0;
+  array->capacity = 0;
+  array->committed = 0;
+}
+
+static inline Void ARRAY_DESTROY(ARRAY_ELEMENT)(ARRAY_TYPE(ARRAY_ELEMENT) * array)
+{
+  if (array->data) {
+    platform_virtual_release_tagged(
+        array->data, (Size) array->reserved, (Size) array->committed, MEMORY_TAG_NONE);
+  }
+  memset(array, 0, sizeof(*array));
+}
+
+// Commits enough memory for `capacity` elements.
+static inline Bool ARRAY_RESERVE(ARRAY_ELEMENT)(ARRAY_TYPE(ARRAY_ELEMENT) * array, Index capacity)
+{
+  if (capacity <= array->capacity) {
+    return true;
+  }
+  if (capacity > array->maximum) {
+    return false;
+  }
+
+  const Index g = ARRAY_COMMIT_GRANULARITY;
+  const Index bytes = capacity * (Index) sizeof(ARRAY_ELEMENT);
+  const Index target = MIN((bytes + g - 1) / g * g, array->reserved);
+  Byte* const start = (Byte*) array->data + array->committed;
+  const Size size = (Size) (target - array->committed);
+  if (platform_virtual_commit_tagged(start, size, MEMORY_TAG_NONE) == false) {
+    return false;
+  }
+
+  array->committed = target;
+  array->capacity = target / (Index) sizeof(ARRAY_ELEMENT);
+  return true;
+}
+
+static inline Bool ARRAY_PUSH(ARRAY_ELEMENT)(ARRAY_TYPE(ARRAY_ELEMENT) * array, ARRAY_ELEMENT element)
+{
+  if (array->length == array->capacity && ARRAY_RESERVE(ARRAY_ELEMENT)(array, array->length + 1) == false) {
+    return false;
+  }
+  array->data[array->length] = element;
+  array->length += 1;
+  return true;
+}
+
+static inline ARRAY_ELEMENT ARRAY_POP(ARRAY_ELEMENT)(ARRAY_TYPE(ARRAY_ELEMENT) * array, ARRAY_ELEMENT sentinel)
+{
+  if (array->length > 0) {
+    array->length -= 1;
+    return array->data[array->length];
+  } else {
+    return sentinel;
+  }
+}
+
+// Shifts later elements up by one to preserve order.
+static inline Bool ARRAY_INSERT(ARRAY_ELEMENT)(ARRAY_TYPE(ARRAY_ELEMENT) * array, Index index, ARRAY_ELEMENT element)
+{
+  ASSERT(index >= 0 && index <= array->length);
+  if (ARRAY_RESERVE(ARRAY_ELEMENT)(array, array->length + 1) == false) {
+    return false;
+  }
+  ARRAY_ELEMENT* const slot = array->data + index;
+  memmove(slot + 1, slot, (array->length - index) * sizeof(ARRAY_ELEMENT));
+  *slot = element;
+  array->length += 1;
+  return true;
+}
+
+// Moves the last element into the hole, so order is not preserved.
+static inline Void ARRAY_REMOVE_SWAP(ARRAY_ELEMENT)(ARRAY_TYPE(ARRAY_ELEMENT) * array, Index index)
+{
+  ASSERT(index >= 0 && index < array->length);
+  array->length -= 1;
+  array->data[index] = array->data[array->length];
+}
+
+static inline Bool ARRAY_APPEND(ARRAY_ELEMENT)(ARRAY_TYPE(ARRAY_ELEMENT) * array, const ARRAY_ELEMENT* elements, Index count)
+{
+  if (ARRAY_RESERVE(ARRAY_ELEMENT)(array, array->length + count) == false) {
+    return false;
+  }
+  memcpy(array->data + array->length, elements, count * sizeof(ARRAY_ELEMENT));
+  array->length += count;
+  return true;
+}
+
+// Keeps committed memory for reuse.
+static inline Void ARRAY_CLEAR(ARRAY_ELEMENT)(ARRAY_TYPE(ARRAY_ELEMENT) * array)
+{
+  array->length = 0;
+}
+
+#undef ARRAY_ELEMENT
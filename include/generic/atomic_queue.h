@@ -2,12 +2,18 @@
  * GENERIC LOCK FREE QUEUE
  *
  * The user should define ATOMIC_QUEUE_ELEMENT as the type parameter.
+ *
+ * A bounded queue for exactly one producer thread and one consumer thread.
+ * Each side owns one index on its own cache line, and keeps a cached copy of
+ * the other side's index, so it only touches the shared line when the cached
+ * copy says the queue is full (or empty). The capacity must be a power of two.
  ******************************************************************************/
 
 #ifndef GENERIC_ATOMIC_QUEUE_H
 #define GENERIC_ATOMIC_QUEUE_H
 
 #include <stdatomic.h>
+#include <string.h>
 #include "prelude.h"
 
 #define ATOMIC_QUEUE_CAT(a, ...) ATOMIC_QUEUE_CAT_(a, __VA_ARGS__)
@@ -16,18 +22,28 @@
 #define ATOMIC_QUEUE_INIT(T) ATOMIC_QUEUE_CAT(atomic_queue_init_, T)
 #define ATOMIC_QUEUE_ENQUEUE(T) ATOMIC_QUEUE_CAT(atomic_queue_enqueue_, T)
 #define ATOMIC_QUEUE_DEQUEUE(T) ATOMIC_QUEUE_CAT(atomic_queue_dequeue_, T)
+#define ATOMIC_QUEUE_ENQUEUE_MANY(T) ATOMIC_QUEUE_CAT(atomic_queue_enqueue_many_, T)
+#define ATOMIC_QUEUE_DEQUEUE_MANY(T) ATOMIC_QUEUE_CAT(atomic_queue_dequeue_many_, T)
 #define ATOMIC_QUEUE_LENGTH(T) ATOMIC_QUEUE_CAT(atomic_queue_length_, T)
 
 #endif
 
 #ifdef ATOMIC_QUEUE_INTERFACE
 
+// Indices count elements since initialization, and are masked on access.
 typedef struct ATOMIC_QUEUE_TYPE(ATOMIC_QUEUE_ELEMENT) {
-  Index capacity;
-  Index producer;
-  Index consumer;
-  _Atomic Index length;
+
+  Index mask;
   ATOMIC_QUEUE_ELEMENT* buffer;
+
+  // written by the producer
+  _Alignas(CACHE_LINE) _Atomic Index head;
+  Index tail_cache;
+
+  // written by the consumer
+  _Alignas(CACHE_LINE) _Atomic Index tail;
+  Index head_cache;
+
 } ATOMIC_QUEUE_TYPE(ATOMIC_QUEUE_ELEMENT);
 
 #endif
@@ -39,63 +55,102 @@ static inline Void ATOMIC_QUEUE_INIT(ATOMIC_QUEUE_ELEMENT)(
     ATOMIC_QUEUE_ELEMENT* buffer,
     Index capacity)
 {
-  queue->capacity = capacity;
-  queue->producer = 0;
-  queue->consumer = 0;
-  queue->length = 0;
+  ASSERT(capacity > 0 && (capacity & (capacity - 1)) == 0);
+  queue->mask = capacity - 1;
   queue->buffer = buffer;
+  atomic_init(&queue->head, 0);
+  atomic_init(&queue->tail, 0);
+  queue->tail_cache = 0;
+  queue->head_cache = 0;
 }
 
-static inline Void ATOMIC_QUEUE_ENQUEUE(ATOMIC_QUEUE_ELEMENT)(
+// Producer only. Returns false if the queue is full.
+static inline Bool ATOMIC_QUEUE_ENQUEUE(ATOMIC_QUEUE_ELEMENT)(
     ATOMIC_QUEUE_TYPE(ATOMIC_QUEUE_ELEMENT)* queue,
     ATOMIC_QUEUE_ELEMENT element)
 {
-  if (message_queue_length(queue) < queue->capacity) {
-
-    // write the message into the buffer and update the producer head
-    queue->buffer[queue->producer] = message;
-    queue->producer = (queue->producer + 1) % queue->capacity;
-
-    // increment the queue length
-    Bool swapped = false;
-    while (swapped == false) {
-      Index length = ATOMIC_QUEUE_LENGTH(ATOMIC_QUEUE_ELEMENT)(queue);
-      swapped = atomic_compare_exchange_weak(&queue->length, &length, length + 1);
+  const Index head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  if (head - queue->tail_cache > queue->mask) {
+    queue->tail_cache = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head - queue->tail_cache > queue->mask) {
+      return false;
     }
-
   }
+  queue->buffer[head & queue->mask] = element;
+  atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+  return true;
 }
 
+// Consumer only. Returns the sentinel if the queue is empty.
 static inline ATOMIC_QUEUE_ELEMENT ATOMIC_QUEUE_DEQUEUE(ATOMIC_QUEUE_ELEMENT)(
-    ATOMIC_QUEUE_TYPE(QUEUE_ELEMENT)* queue,
+    ATOMIC_QUEUE_TYPE(ATOMIC_QUEUE_ELEMENT)* queue,
     ATOMIC_QUEUE_ELEMENT sentinel)
 {
-  if (ATOMIC_QUEUE_LENGTH(ATOMIC_QUEUE_ELEMENT)(queue) > 0) {
-
-    // read the message out
-    const ATOMIC_QUEUE_ELEMENT out = queue->buffer[queue->consumer];
-    queue->consumer = (queue->consumer + 1) % queue->capacity;
-
-    // decrement the queue length
-    Bool swapped = false;
-    while (swapped == false) {
-      Index length = ATOMIC_QUEUE_LENGTH(ATOMIC_QUEUE_ELEMENT)(queue);
-      swapped = atomic_compare_exchange_weak(&queue->length, &length, length - 1);
+  const Index tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  if (tail == queue->head_cache) {
+    queue->head_cache = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail == queue->head_cache) {
+      return sentinel;
     }
+  }
+  const ATOMIC_QUEUE_ELEMENT out = queue->buffer[tail & queue->mask];
+  atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+  return out;
+}
 
-    return out;
+// Producer only. Enqueues as many elements as fit, with at most two copies,
+// and returns the number enqueued.
+static inline Index ATOMIC_QUEUE_ENQUEUE_MANY(ATOMIC_QUEUE_ELEMENT)(
+    ATOMIC_QUEUE_TYPE(ATOMIC_QUEUE_ELEMENT)* queue,
+    const ATOMIC_QUEUE_ELEMENT* elements,
+    Index count)
+{
+  const Index capacity = queue->mask + 1;
+  const Index head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  if (capacity - (head - queue->tail_cache) < count) {
+    queue->tail_cache = atomic_load_explicit(&queue->tail, memory_order_acquire);
+  }
+  const Index n = MIN(count, capacity - (head - queue->tail_cache));
 
-  } else {
+  const Index start = head & queue->mask;
+  const Index first = MIN(n, capacity - start);
+  memcpy(queue->buffer + start, elements, first * sizeof(*elements));
+  memcpy(queue->buffer, elements + first, (n - first) * sizeof(*elements));
 
-    return sentinel;
+  atomic_store_explicit(&queue->head, head + n, memory_order_release);
+  return n;
+}
 
+// Consumer only. Dequeues up to `count` elements, with at most two copies,
+// and returns the number dequeued.
+static inline Index ATOMIC_QUEUE_DEQUEUE_MANY(ATOMIC_QUEUE_ELEMENT)(
+    ATOMIC_QUEUE_TYPE(ATOMIC_QUEUE_ELEMENT)* queue,
+    ATOMIC_QUEUE_ELEMENT* out,
+    Index count)
+{
+  const Index capacity = queue->mask + 1;
+  const Index tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  if (queue->head_cache - tail < count) {
+    queue->head_cache = atomic_load_explicit(&queue->head, memory_order_acquire);
   }
+  const Index n = MIN(count, queue->head_cache - tail);
+
+  const Index start = tail & queue->mask;
+  const Index first = MIN(n, capacity - start);
+  memcpy(out, queue->buffer + start, first * sizeof(*out));
+  memcpy(out + first, queue->buffer, (n - first) * sizeof(*out));
+
+  atomic_store_explicit(&queue->tail, tail + n, memory_order_release);
+  return n;
 }
 
+// Exact when called from either side; otherwise a snapshot.
 static inline Index ATOMIC_QUEUE_LENGTH(ATOMIC_QUEUE_ELEMENT)(
-    const ATOMIC_QUEUE_TYPE(ATOMIC_QUEUE_ELEMENT)* queue)
+    ATOMIC_QUEUE_TYPE(ATOMIC_QUEUE_ELEMENT)* queue)
 {
-  return atomic_load(&queue->length);
+  const Index tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+  const Index head = atomic_load_explicit(&queue->head, memory_order_acquire);
+  return head - tail;
 }
 
 #endif
@@ -0,0 +1,174 @@
+/*******************************************************************************
+ * GENERIC BITSET
+ *
+ * A fixed-size set of bits, stored as 64-bit words. Storage is rounded up to
+ * whole groups of four words, so the bulk operations run over 256 bits at a
+ * time with no remainder loop, and the compiler is free to vectorize them.
+ * Bits beyond the requested count are kept clear.
+ *
+ * To visit the set bits:
+ *
+ *   for (Index i = bitset_next(&set, 0); i != INDEX_NONE; i = bitset_next(&set, i + 1))
+ *
+ * which skips empty words and finds each bit with count-trailing-zeros.
+ ******************************************************************************/
+
+#pragma once
+
+#include <string.h>
+#include "prelude.h"
+#include "memory.h"
+#include "bits.h"
+
+#define BITSET_GROUP 4
+#define BITSET_WORDS(bits) ((((bits) + 64 * BITSET_GROUP - 1) / (64 * BITSET_GROUP)) * BITSET_GROUP)
+
+typedef struct
+{
+  Index bits;
+  Index words;    // a multiple of BITSET_GROUP
+  U64* data;
+} Bitset;
+
+// The caller supplies BITSET_WORDS(bits) words of storage.
+static inline Void bitset_init(Bitset* set, U64* data, Index bits)
+{
+  set->bits = bits;
+  set->words = BITSET_WORDS(bits);
+  set->data = data;
+  memset(data, 0, set->words * sizeof(U64));
+}
+
+// Backs the bitset with its own virtual allocation.
+static inline Void bitset_create(Bitset* set, Index bits)
+{
+  U64* const data = platform_virtual_alloc(BITSET_WORDS(bits) * sizeof(U64));
+  bitset_init(set, data, bits);
+}
+
+static inline Void bitset_destroy(Bitset* set)
+{
+  platform_virtual_free(set->data);
+  set->bits = 0;
+  set->words = 0;
+  set->data = NULL;
+}
+
+static inline Bool bitset_test(const Bitset* set, Index bit)
+{
+  ASSERT(bit >= 0 && bit < set->bits);
+  return (set->data[bit >> 6] >> (bit & 63)) & 1;
+}
+
+static inline Void bitset_set(Bitset* set, Index bit)
+{
+  ASSERT(bit >= 0 && bit < set->bits);
+  set->data[bit >> 6] |= (U64) 1 << (bit & 63);
+}
+
+static inline Void bitset_clear(Bitset* set, Index bit)
+{
+  ASSERT(bit >= 0 && bit < set->bits);
+  set->data[bit >> 6] &= ~((U64) 1 << (bit & 63));
+}
+
+// Sets or clears the bits in [first, last), a word at a time.
+static inline Void bitset_assign_range(Bitset* set, Index first, Index last, Bool value)
+{
+  ASSERT(first >= 0 && first <= last && last <= set->bits);
+  while (first < last) {
+    const Index word = first >> 6;
+    const Index end = MIN(last, (word + 1) << 6);
+    const S32 width = (S32) (end - first);
+    const U64 mask = (width == 64 ? ~(U64) 0 : (((U64) 1 << width) - 1)) << (first & 63);
+    if (value) {
+      set->data[word] |= mask;
+    } else {
+      set->data[word] &= ~mask;
+    }
+    first = end;
+  }
+}
+
+static inline Void bitset_set_range(Bitset* set, Index first, Index last)
+{
+  bitset_assign_range(set, first, last, true);
+}
+
+static inline Void bitset_clear_range(Bitset* set, Index first, Index last)
+{
+  bitset_assign_range(set, first, last, false);
+}
+
+static inline Void bitset_clear_all(Bitset* set)
+{
+  memset(set->data, 0, set->words * sizeof(U64));
+}
+
+// The binary operations require sets of the same size.
+
+static inline Void bitset_and(Bitset* set, const Bitset* other)
+{
+  ASSERT(set->words == other->words);
+  U64* restrict const a = set->data;
+  const U64* restrict const b = other->data;
+  for (Index i = 0; i < set->words; i++) {
+    a[i] &= b[i];
+  }
+}
+
+static inline Void bitset_or(Bitset* set, const Bitset* other)
+{
+  ASSERT(set->words == other->words);
+  U64* restrict const a = set->data;
+  const U64* restrict const b = other->data;
+  for (Index i = 0; i < set->words; i++) {
+    a[i] |= b[i];
+  }
+}
+
+static inline Void bitset_and_not(Bitset* set, const Bitset* other)
+{
+  ASSERT(set->words == other->words);
+  U64* restrict const a = set->data;
+  const U64* restrict const b = other->data;
+  for (Index i = 0; i < set->words; i++) {
+    a[i] &= ~b[i];
+  }
+}
+
+static inline Index bitset_count(const Bitset* set)
+{
+  Index count = 0;
+  for (Index i = 0; i < set->words; i++) {
+    count += bits_popcount64(set->data[i]);
+  }
+  return count;
+}
+
+static inline Bool bitset_any(const Bitset* set)
+{
+  U64 any = 0;
+  for (Index i = 0; i < set->words; i++) {
+    any |= set->data[i];
+  }
+  return any != 0;
+}
+
+// Returns the first set bit at or after `bit`, or INDEX_NONE.
+static inline Index bitset_next(const Bitset* set, Index bit)
+{
+  if (bit >= set->bits) {
+    return INDEX_NONE;
+  }
+  Index word = bit >> 6;
+  U64 bits = set->data[word] & (~(U64) 0 << (bit & 63));
+  while (bits == 0) {
+    word += 1;
+    if (word == set->words) {
+      return INDEX_NONE;
+    }
+    bits = set->data[word];
+  }
+  return (word << 6) + bits_ctz64(bits);
+}
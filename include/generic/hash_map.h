@@ -0,0 +1,295 @@
+/*******************************************************************************
+ * GENERIC HASH MAP
+ *
+ * The user should define HASH_MAP_KEY and HASH_MAP_VALUE as the type
+ * parameters. HASH_MAP_HASH(key) should evaluate to a well mixed U64, and
+ * defaults to hash_map_mix on the key converted to an integer. HASH_MAP_EQUAL
+ * (a, b) defaults to ==.
+ *
+ * An open addressing table in the style of Swiss tables. Each slot has a
+ * control byte, which is either empty or holds seven bits of the key's hash.
+ * Lookups compare sixteen control bytes at a time, with SSE2 where available,
+ * and only compare keys whose control bytes match.
+ *
+ * Probing is linear, one slot at a time, so deletion shifts later entries of
+ * the probe sequence back into the hole, and no tombstones are needed. The
+ * first group of control bytes is mirrored after the last, so a group can be
+ * loaded starting at any slot.
+ *
+ * Storage comes from an arena. When the table grows, the old storage is
+ * abandoned to the arena.
+ ******************************************************************************/
+
+#ifndef GENERIC_HASH_MAP_H
+#define GENERIC_HASH_MAP_H
+
+#include <string.h>
+#include "prelude.h"
+#include "bits.h"
+#include "arena.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define HASH_MAP_SSE2
+#include <emmintrin.h>
+#endif
+
+#define HASH_MAP_GROUP 16
+#define HASH_MAP_EMPTY 0x80
+#define HASH_MAP_MINIMUM 16
+
+#define HASH_MAP_CAT(a, ...) HASH_MAP_CAT_(a, __VA_ARGS__)
+#define HASH_MAP_CAT_(a, ...) a##__VA_ARGS__
+#define HASH_MAP_NAME(K, V) HASH_MAP_CAT(K, HASH_MAP_CAT(_, V))
+#define HASH_MAP_TYPE(K, V) HASH_MAP_CAT(HashMap, HASH_MAP_NAME(K, V))
+#define HASH_MAP_INIT(K, V) HASH_MAP_CAT(hash_map_init_, HASH_MAP_NAME(K, V))
+#define HASH_MAP_FIND(K, V) HASH_MAP_CAT(hash_map_find_, HASH_MAP_NAME(K, V))
+#define HASH_MAP_INSERT(K, V) HASH_MAP_CAT(hash_map_insert_, HASH_MAP_NAME(K, V))
+#define HASH_MAP_REMOVE(K, V) HASH_MAP_CAT(hash_map_remove_, HASH_MAP_NAME(K, V))
+#define HASH_MAP_CLEAR(K, V) HASH_MAP_CAT(hash_map_clear_, HASH_MAP_NAME(K, V))
+#define HASH_MAP_COUNT(K, V) HASH_MAP_CAT(hash_map_count_, HASH_MAP_NAME(K, V))
+#define HASH_MAP_LOOKUP_(K, V) HASH_MAP_CAT(hash_map_lookup_, HASH_MAP_NAME(K, V))
+#define HASH_MAP_ALLOCATE_(K, V) HASH_MAP_CAT(hash_map_allocate_, HASH_MAP_NAME(K, V))
+#define HASH_MAP_GROW_(K, V) HASH_MAP_CAT(hash_map_grow_, HASH_MAP_NAME(K, V))
+#define HASH_MAP_SET_CONTROL_(K, V) HASH_MAP_CAT(hash_map_set_control_, HASH_MAP_NAME(K, V))
+
+// splitmix64 finalizer
+static inline U64 hash_map_mix(U64 x)
+{
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ull;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBull;
+  x ^= x >> 31;
+  return x;
+}
+
+// FNV-1a, mixed so that the low and high bits are both usable
+static inline U64 hash_map_string(const Char* string)
+{
+  U64 hash = 0xCBF29CE484222325ull;
+  for (const Char* c = string; *c; c++) {
+    hash ^= (U8) *c;
+    hash *= 0x100000001B3ull;
+  }
+  return hash_map_mix(hash);
+}
+
+// Returns a bit mask of the bytes in the group equal to `byte`.
+static inline U32 hash_map_match(const U8* group, U8 byte)
+{
+#ifdef HASH_MAP_SSE2
+  const __m128i bytes = _mm_loadu_si128((const __m128i*) group);
+  const __m128i pattern = _mm_set1_epi8((char) byte);
+  return (U32) _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, pattern));
+#else
+  U32 mask = 0;
+  for (S32 i = 0; i < HASH_MAP_GROUP; i++) {
+    mask |= (U32) (group[i] == byte) << i;
+  }
+  return mask;
+#endif
+}
+
+#endif
+
+#ifndef HASH_MAP_HASH
+#define HASH_MAP_HASH(key) hash_map_mix((U64) (key))
+#endif
+
+#ifndef HASH_MAP_EQUAL
+#define HASH_MAP_EQUAL(a, b) ((a) == (b))
+#endif
+
+typedef struct
+{
+  Index mask;                 // capacity - 1
+  Index count;
+  U8* control;                // capacity + HASH_MAP_GROUP bytes
+  HASH_MAP_KEY* keys;
+  HASH_MAP_VALUE* values;
+  Arena* arena;
+} HASH_MAP_TYPE(HASH_MAP_KEY, HASH_MAP_VALUE);
+
+static inline Void HASH_MAP_SET_CONTROL_(HASH_MAP_KEY, HASH_MAP_VALUE)(
+    HASH_MAP_TYPE(HASH_MAP_KEY, HASH_MAP_VALUE)* map,
+    Index slot,
+    U8 control)
+{
+  map->control[slot] = control;
+  if (slot < HASH_MAP_GROUP) {
+    map->control[map->mask + 1 + slot] = control;
+  }
+}
+
+static inline Bool HASH_MAP_ALLOCATE_(HASH_MAP_KEY, HASH_MAP_VALUE)(
+    HASH_MAP_TYPE(HASH_MAP_KEY, HASH_MAP_VALUE)* map,
+    Index capacity)
+{
+  U8* const control = ARENA_PUSH_ARRAY(map->arena, U8, capacity + HASH_MAP_GROUP);
+  HASH_MAP_KEY* const keys = ARENA_PUSH_ARRAY(map->arena, HASH_MAP_KEY, capacity);
+  HASH_MAP_VALUE* const values = ARENA_PUSH_ARRAY(map->arena, HASH_MAP_VALUE, capacity);
+  if (control == NULL || keys == NULL || values == NULL) {
+    return false;
+  }
+  memset(control, HASH_MAP_EMPTY, capacity + HASH_MAP_GROUP);
+  map->mask = capacity - 1;
+  map->count = 0;
+  map->control = control;
+  map->keys = keys;
+  map->values = values;
+  return true;
+}
+
+// Sizes the table to hold `capacity` entries without growing.
+static inline Bool HASH_MAP_INIT(HASH_MAP_KEY, HASH_MAP_VALUE)(
+    HASH_MAP_TYPE(HASH_MAP_KEY, HASH_MAP_VALUE)* map,
+    Arena* arena,
+    Index capacity)
+{
+  const Index slots = (Index) bits_ceil_pow2((U64) (capacity + capacity / 7 + 1));
+  map->arena = arena;
+  return HASH_MAP_ALLOCATE_(HASH_MAP_KEY, HASH_MAP_VALUE)(map, MAX(slots, HASH_MAP_MINIMUM));
+}
+
+// Returns the slot holding the key, or INDEX_NONE.
+static inline Index HASH_MAP_LOOKUP_(HASH_MAP_KEY, HASH_MAP_VALUE)(
+    const HASH_MAP_TYPE(HASH_MAP_KEY, HASH_MAP_VALUE)* map,
+    HASH_MAP_KEY key,
+    U64 hash)
+{
+  const U8 tag = (U8) (hash & 0x7F);
+  Index position = (Index) (hash >> 7) & map->mask;
+  for (;;) {
+    const U8* const group = map->control + position;
+    U32 matches = hash_map_match(group, tag);
+    while (matches) {
+      const Index slot = (position + bits_ctz32(matches)) & map->mask;
+      if (HASH_MAP_EQUAL(map->keys[slot], key)) {
+        return slot;
+      }
+      matches &= matches - 1;
+    }
+    if (hash_map_match(group, HASH_MAP_EMPTY)) {
+      return INDEX_NONE;
+    }
+    position = (position + HASH_MAP_GROUP) & map->mask;
+  }
+}
+
+static inline HASH_MAP_VALUE* HASH_MAP_FIND(HASH_MAP_KEY, HASH_MAP_VALUE)(
+    const HASH_MAP_TYPE(HASH_MAP_KEY, HASH_MAP_VALUE)* map,
+    HASH_MAP_KEY key)
+{
+  const U64 hash = HASH_MAP_HASH(key);
+  const Index slot = HASH_MAP_LOOKUP_(HASH_MAP_KEY, HASH_MAP_VALUE)(map, key, hash);
+  return slot == INDEX_NONE ? NULL : &map->values[slot];
+}
+
+static inline Bool HASH_MAP_GROW_(HASH_MAP_KEY, HASH_MAP_VALUE)(
+    HASH_MAP_TYPE(HASH_MAP_KEY, HASH_MAP_VALUE)* map);
+
+// Inserts or overwrites. Returns false if the arena is exhausted.
+static inline Bool HASH_MAP_INSERT(HASH_MAP_KEY, HASH_MAP_VALUE)(
+    HASH_MAP_TYPE(HASH_MAP_KEY, HASH_MAP_VALUE)* map,
+    HASH_MAP_KEY key,
+    HASH_MAP_VALUE value)
+{
+  const U64 hash = HASH_MAP_HASH(key);
+  const Index existing = HASH_MAP_LOOKUP_(HASH_MAP_KEY, HASH_MAP_VALUE)(map, key, hash);
+  if (existing != INDEX_NONE) {
+    map->values[existing] = value;
+    return true;
+  }
+
+  // keep the load factor at or below 7/8
+  const Index capacity = map->mask + 1;
+  if (8 * (map->count + 1) > 7 * capacity) {
+    if (HASH_MAP_GROW_(HASH_MAP_KEY, HASH_MAP_VALUE)(map) == false) {
+      return false;
+    }
+  }
+
+  Index position = (Index) (hash >> 7) & map->mask;
+  U32 empty = hash_map_match(map->control + position, HASH_MAP_EMPTY);
+  while (empty == 0) {
+    position = (position + HASH_MAP_GROUP) & map->mask;
+    empty = hash_map_match(map->control + position, HASH_MAP_EMPTY);
+  }
+
+  const Index slot = (position + bits_ctz32(empty)) & map->mask;
+  HASH_MAP_SET_CONTROL_(HASH_MAP_KEY, HASH_MAP_VALUE)(map, slot, (U8) (hash & 0x7F));
+  map->keys[slot] = key;
+  map->values[slot] = value;
+  map->count += 1;
+  return true;
+}
+
+static inline Bool HASH_MAP_GROW_(HASH_MAP_KEY, HASH_MAP_VALUE)(
+    HASH_MAP_TYPE(HASH_MAP_KEY, HASH_MAP_VALUE)* map)
+{
+  HASH_MAP_TYPE(HASH_MAP_KEY, HASH_MAP_VALUE) old = *map;
+  const Index capacity = 2 * (old.mask + 1);
+  if (HASH_MAP_ALLOCATE_(HASH_MAP_KEY, HASH_MAP_VALUE)(map, capacity) == false) {
+    *map = old;
+    return false;
+  }
+  for (Index i = 0; i <= old.mask; i++) {
+    if (old.control[i] != HASH_MAP_EMPTY) {
+      HASH_MAP_INSERT(HASH_MAP_KEY, HASH_MAP_VALUE)(map, old.keys[i], old.values[i]);
+    }
+  }
+  return true;
+}
+
+// Returns false if the key was not present.
+static inline Bool HASH_MAP_REMOVE(HASH_MAP_KEY, HASH_MAP_VALUE)(
+    HASH_MAP_TYPE(HASH_MAP_KEY, HASH_MAP_VALUE)* map,
+    HASH_MAP_KEY key)
+{
+  const U64 hash = HASH_MAP_HASH(key);
+  Index hole = HASH_MAP_LOOKUP_(HASH_MAP_KEY, HASH_MAP_VALUE)(map, key, hash);
+  if (hole == INDEX_NONE) {
+    return false;
+  }
+
+  // Shift back each following entry whose home slot is not in the cyclic
+  // range (hole, slot], until the probe sequence ends at an empty slot.
+  Index slot = hole;
+  for (;;) {
+    slot = (slot + 1) & map->mask;
+    if (map->control[slot] == HASH_MAP_EMPTY) {
+      break;
+    }
+    const Index home = (Index) (HASH_MAP_HASH(map->keys[slot]) >> 7) & map->mask;
+    const Index distance_home = (slot - home) & map->mask;
+    const Index distance_hole = (slot - hole) & map->mask;
+    if (distance_home >= distance_hole) {
+      HASH_MAP_SET_CONTROL_(HASH_MAP_KEY, HASH_MAP_VALUE)(map, hole, map->control[slot]);
+      map->keys[hole] = map->keys[slot];
+      map->values[hole] = map->values[slot];
+      hole = slot;
+    }
+  }
+
+  HASH_MAP_SET_CONTROL_(HASH_MAP_KEY, HASH_MAP_VALUE)(map, hole, HASH_MAP_EMPTY);
+  map->count -= 1;
+  return true;
+}
+
+static inline Void HASH_MAP_CLEAR(HASH_MAP_KEY, HASH_MAP_VALUE)(
+    HASH_MAP_TYPE(HASH_MAP_KEY, HASH_MAP_VALUE)* map)
+{
+  memset(map->control, HASH_MAP_EMPTY, map->mask + 1 + HASH_MAP_GROUP);
+  map->count = 0;
+}
+
+static inline Index HASH_MAP_COUNT(HASH_MAP_KEY, HASH_MAP_VALUE)(
+    const HASH_MAP_TYPE(HASH_MAP_KEY, HASH_MAP_VALUE)* map)
+{
+  return map->count;
+}
+
+#undef HASH_MAP_KEY
+#undef HASH_MAP_VALUE
+#undef HASH_MAP_HASH
+#undef HASH_MAP_EQUAL
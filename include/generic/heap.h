@@ -0,0 +1,168 @@
+/*******************************************************************************
+ * GENERIC HEAP
+ *
+ * The user should define HEAP_ELEMENT as the type parameter. HEAP_LESS(a, b)
+ * orders the elements and defaults to <. HEAP_ARITY sets the number of
+ * children per node and defaults to 4.
+ *
+ * If HEAP_MOVED(element, index) is defined, it is invoked whenever an element
+ * is placed at a new index, so that the user can track the positions needed
+ * for HEAP_DECREASE.
+ ******************************************************************************/
+
+#ifndef GENERIC_HEAP_H
+#define GENERIC_HEAP_H
+
+#include "prelude.h"
+
+#define HEAP_CAT(a, ...) HEAP_CAT_(a, __VA_ARGS__)
+#define HEAP_CAT_(a, ...) a##__VA_ARGS__
+#define HEAP_TYPE(T) HEAP_CAT(Heap, T)
+#define HEAP_INIT(T) HEAP_CAT(heap_init_, T)
+#define HEAP_PUSH(T) HEAP_CAT(heap_push_, T)
+#define HEAP_POP(T) HEAP_CAT(heap_pop_, T)
+#define HEAP_PEEK(T) HEAP_CAT(heap_peek_, T)
+#define HEAP_DECREASE(T) HEAP_CAT(heap_decrease_, T)
+#define HEAP_HEAPIFY(T) HEAP_CAT(heap_heapify_, T)
+#define HEAP_SIZE(T) HEAP_CAT(heap_size_, T)
+#define HEAP_SIFT_UP_(T) HEAP_CAT(heap_sift_up_, T)
+#define HEAP_SIFT_DOWN_(T) HEAP_CAT(heap_sift_down_, T)
+
+#endif
+
+#ifndef HEAP_LESS
+#define HEAP_LESS(a, b) ((a) < (b))
+#endif
+
+// Four 8-byte children fit in one cache line, so a sift down reads one line
+// of children per level, as a binary heap does, but over half the levels.
+// That pays off when the heap is bigger than the cache. When it fits, the
+// extra comparisons cancel it out: example/benchmark.c measures that case,
+// with the two within a few percent of each other.
+#ifndef HEAP_ARITY
+#define HEAP_ARITY 4
+#endif
+
+#ifdef HEAP_MOVED
+#define HEAP_PLACE_(heap, index, element) \
+  ((heap)->data[(index)] = (element), HEAP_MOVED((heap)->data[(index)], (index)))
+#else
+#define HEAP_PLACE_(heap, index, element) ((heap)->data[(index)] = (element))
+#endif
+
+typedef struct
+{
+  Index capacity;
+  Index length;
+  HEAP_ELEMENT* data;
+} HEAP_TYPE(HEAP_ELEMENT);
+
+static inline Void HEAP_INIT(HEAP_ELEMENT)(HEAP_TYPE(HEAP_ELEMENT) * heap, HEAP_ELEMENT* data, Index capacity)
+{
+  heap->capacity = capacity;
+  heap->length = 0;
+  heap->data = data;
+}
+
+// Moves the element up from `index`, shifting parents down into the hole.
+static inline Void HEAP_SIFT_UP_(HEAP_ELEMENT)(HEAP_TYPE(HEAP_ELEMENT) * heap, Index index, HEAP_ELEMENT element)
+{
+  while (index > 0) {
+    const Index parent = (index - 1) / HEAP_ARITY;
+    if (!HEAP_LESS(element, heap->data[parent])) {
+      break;
+    }
+    HEAP_PLACE_(heap, index, heap->data[parent]);
+    index = parent;
+  }
+  HEAP_PLACE_(heap, index, element);
+}
+
+// Moves the element down from `index`, shifting the least child up into the
+// hole.
+static inline Void HEAP_SIFT_DOWN_(HEAP_ELEMENT)(HEAP_TYPE(HEAP_ELEMENT) * heap, Index index, HEAP_ELEMENT element)
+{
+  for (;;) {
+    const Index first = HEAP_ARITY * index + 1;
+    if (first >= heap->length) {
+      break;
+    }
+    const Index last = MIN(first + HEAP_ARITY, heap->length);
+    Index least = first;
+    for (Index child = first + 1; child < last; child++) {
+      if (HEAP_LESS(heap->data[child], heap->data[least])) {
+        least = child;
+      }
+    }
+    if (!HEAP_LESS(heap->data[least], element)) {
+      break;
+    }
+    HEAP_PLACE_(heap, index, heap->data[least]);
+    index = least;
+  }
+  HEAP_PLACE_(heap, index, element);
+}
+
+// Returns false if the heap is full.
+static inline Bool HEAP_PUSH(HEAP_ELEMENT)(HEAP_TYPE(HEAP_ELEMENT) * heap, HEAP_ELEMENT element)
+{
+  if (heap->length == heap->capacity) {
+    return false;
+  }
+  heap->length += 1;
+  HEAP_SIFT_UP_(HEAP_ELEMENT)(heap, heap->length - 1, element);
+  return true;
+}
+
+static inline HEAP_ELEMENT HEAP_POP(HEAP_ELEMENT)(HEAP_TYPE(HEAP_ELEMENT) * heap, HEAP_ELEMENT sentinel)
+{
+  if (heap->length == 0) {
+    return sentinel;
+  }
+  const HEAP_ELEMENT least = heap->data[0];
+  heap->length -= 1;
+  if (heap->length > 0) {
+    HEAP_SIFT_DOWN_(HEAP_ELEMENT)(heap, 0, heap->data[heap->length]);
+  }
+  return least;
+}
+
+static inline HEAP_ELEMENT HEAP_PEEK(HEAP_ELEMENT)(const HEAP_TYPE(HEAP_ELEMENT) * heap, HEAP_ELEMENT sentinel)
+{
+  return heap->length > 0 ? heap->data[0] : sentinel;
+}
+
+// Replaces the element at `index` with one that is not greater.
+static inline Void HEAP_DECREASE(HEAP_ELEMENT)(HEAP_TYPE(HEAP_ELEMENT) * heap, Index index, HEAP_ELEMENT element)
+{
+  ASSERT(index >= 0 && index < heap->length);
+  ASSERT(!HEAP_LESS(heap->data[index], element));
+  HEAP_SIFT_UP_(HEAP_ELEMENT)(heap, index, element);
+}
+
+// Orders the first `length` elements of the buffer in linear time.
+static inline Void HEAP_HEAPIFY(HEAP_ELEMENT)(HEAP_TYPE(HEAP_ELEMENT) * heap, Index length)
+{
+  ASSERT(length <= heap->capacity);
+  heap->length = length;
+  for (Index index = (length - 2) / HEAP_ARITY; index >= 0 && length > 1; index--) {
+    HEAP_SIFT_DOWN_(HEAP_ELEMENT)(heap, index, heap->data[index]);
+  }
+#ifdef HEAP_MOVED
+  // leaves that were never displaced still need reporting
+  for (Index index = 0; index < length; index++) {
+    HEAP_MOVED(heap->data[index], index);
+  }
+#endif
+}
+
+static inline Index HEAP_SIZE(HEAP_ELEMENT)(const HEAP_TYPE(HEAP_ELEMENT) * heap)
+{
+  return heap->length;
+}
+
+#undef HEAP_PLACE_
+#undef HEAP_ELEMENT
+#undef HEAP_LESS
+#undef HEAP_ARITY
+#undef HEAP_MOVED
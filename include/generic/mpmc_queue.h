@@ -0,0 +1,146 @@
+/*******************************************************************************
+ * GENERIC MULTI-PRODUCER MULTI-CONSUMER QUEUE
+ *
+ * The user should define MPMC_QUEUE_ELEMENT as the type parameter.
+ *
+ * A bounded lock-free queue for any number of producer and consumer threads,
+ * after Dmitry Vyukov's design. Each cell carries a sequence number saying
+ * whether it is ready to be written or read on the current lap, so producers
+ * and consumers only contend on their own index, and only with each other
+ * when the queue is nearly full or empty. The capacity must be a power of two.
+ ******************************************************************************/
+
+#ifndef GENERIC_MPMC_QUEUE_H
+#define GENERIC_MPMC_QUEUE_H
+
+#include <stdatomic.h>
+#include "prelude.h"
+
+#define MPMC_QUEUE_CAT(a, ...) MPMC_QUEUE_CAT_(a, __VA_ARGS__)
+#define MPMC_QUEUE_CAT_(a, ...) a##__VA_ARGS__
+#define MPMC_QUEUE_TYPE(T) MPMC_QUEUE_CAT(MPMCQueue, T)
+#define MPMC_QUEUE_CELL(T) MPMC_QUEUE_CAT(MPMCQueueCell, T)
+#define MPMC_QUEUE_INIT(T) MPMC_QUEUE_CAT(mpmc_queue_init_, T)
+#define MPMC_QUEUE_ENQUEUE(T) MPMC_QUEUE_CAT(mpmc_queue_enqueue_, T)
+#define MPMC_QUEUE_DEQUEUE(T) MPMC_QUEUE_CAT(mpmc_queue_dequeue_, T)
+#define MPMC_QUEUE_LENGTH(T) MPMC_QUEUE_CAT(mpmc_queue_length_, T)
+
+#endif
+
+#ifdef MPMC_QUEUE_INTERFACE
+
+typedef struct MPMC_QUEUE_CELL(MPMC_QUEUE_ELEMENT) {
+  _Atomic Index sequence;
+  MPMC_QUEUE_ELEMENT element;
+} MPMC_QUEUE_CELL(MPMC_QUEUE_ELEMENT);
+
+typedef struct MPMC_QUEUE_TYPE(MPMC_QUEUE_ELEMENT) {
+
+  Index mask;
+  MPMC_QUEUE_CELL(MPMC_QUEUE_ELEMENT)* cells;
+
+  // claimed by producers
+  _Alignas(CACHE_LINE) _Atomic Index head;
+
+  // claimed by consumers
+  _Alignas(CACHE_LINE) _Atomic Index tail;
+
+} MPMC_QUEUE_TYPE(MPMC_QUEUE_ELEMENT);
+
+#endif
+
+#ifdef MPMC_QUEUE_IMPLEMENTATION
+
+static inline Void MPMC_QUEUE_INIT(MPMC_QUEUE_ELEMENT)(
+    MPMC_QUEUE_TYPE(MPMC_QUEUE_ELEMENT)* queue,
+    MPMC_QUEUE_CELL(MPMC_QUEUE_ELEMENT)* cells,
+    Index capacity)
+{
+  ASSERT(capacity > 0 && (capacity & (capacity - 1)) == 0);
+  queue->mask = capacity - 1;
+  queue->cells = cells;
+  for (Index i = 0; i < capacity; i++) {
+    atomic_init(&cells[i].sequence, i);
+  }
+  atomic_init(&queue->head, 0);
+  atomic_init(&queue->tail, 0);
+}
+
+// Returns false if the queue is full.
+static inline Bool MPMC_QUEUE_ENQUEUE(MPMC_QUEUE_ELEMENT)(
+    MPMC_QUEUE_TYPE(MPMC_QUEUE_ELEMENT)* queue,
+    MPMC_QUEUE_ELEMENT element)
+{
+  MPMC_QUEUE_CELL(MPMC_QUEUE_ELEMENT)* cell = NULL;
+  Index position = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  for (;;) {
+    cell = &queue->cells[position & queue->mask];
+    const Index sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+    const Index difference = sequence - position;
+    if (difference == 0) {
+      // the cell is free on this lap; try to claim it
+      const Bool claimed = atomic_compare_exchange_weak_explicit(
+          &queue->head, &position, position + 1,
+          memory_order_relaxed, memory_order_relaxed);
+      if (claimed) {
+        break;
+      }
+    } else if (difference < 0) {
+      // the cell still holds an element from the previous lap
+      return false;
+    } else {
+      // another producer claimed the cell first
+      position = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    }
+  }
+  cell->element = element;
+  atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+  return true;
+}
+
+// Returns the sentinel if the queue is empty.
+static inline MPMC_QUEUE_ELEMENT MPMC_QUEUE_DEQUEUE(MPMC_QUEUE_ELEMENT)(
+    MPMC_QUEUE_TYPE(MPMC_QUEUE_ELEMENT)* queue,
+    MPMC_QUEUE_ELEMENT sentinel)
+{
+  MPMC_QUEUE_CELL(MPMC_QUEUE_ELEMENT)* cell = NULL;
+  Index position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  for (;;) {
+    cell = &queue->cells[position & queue->mask];
+    const Index sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+    const Index difference = sequence - (position + 1);
+    if (difference == 0) {
+      // the cell has been written on this lap; try to claim it
+      const Bool claimed = atomic_compare_exchange_weak_explicit(
+          &queue->tail, &position, position + 1,
+          memory_order_relaxed, memory_order_relaxed);
+      if (claimed) {
+        break;
+      }
+    } else if (difference < 0) {
+      // the cell has not been written yet
+      return sentinel;
+    } else {
+      // another consumer claimed the cell first
+      position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    }
+  }
+  const MPMC_QUEUE_ELEMENT out = cell->element;
+  atomic_store_explicit(&cell->sequence, position + queue->mask + 1, memory_order_release);
+  return out;
+}
+
+// A snapshot, which may be stale by the time it returns.
+static inline Index MPMC_QUEUE_LENGTH(MPMC_QUEUE_ELEMENT)(
+    MPMC_QUEUE_TYPE(MPMC_QUEUE_ELEMENT)* queue)
+{
+  const Index tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  const Index head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  return MAX(head - tail, 0);
+}
+
+#endif
+
+#undef MPMC_QUEUE_INTERFACE
+#undef MPMC_QUEUE_IMPLEMENTATION
+#undef MPMC_QUEUE_ELEMENT
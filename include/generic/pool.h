@@ -0,0 +1,106 @@
+/*******************************************************************************
+ * GENERIC POOL
+ *
+ * The user should define POOL_ELEMENT as the type parameter.
+ *
+ * Slots are handed out from the front of the buffer, and released slots are
+ * threaded onto an intrusive free list, so allocation and release are O(1)
+ * and live elements stay packed towards the start of the buffer.
+ ******************************************************************************/
+
+#ifndef GENERIC_POOL_H
+#define GENERIC_POOL_H
+
+#include "prelude.h"
+#include "memory.h"
+
+#define POOL_CAT(a, ...) POOL_CAT_(a, __VA_ARGS__)
+#define POOL_CAT_(a, ...) a##__VA_ARGS__
+#define POOL_TYPE(T) POOL_CAT(Pool, T)
+#define POOL_SLOT(T) POOL_CAT(PoolSlot, T)
+#define POOL_INIT(T) POOL_CAT(pool_init_, T)
+#define POOL_CREATE(T) POOL_CAT(pool_create_, T)
+#define POOL_DESTROY(T) POOL_CAT(pool_destroy_, T)
+#define POOL_ALLOC(T) POOL_CAT(pool_alloc_, T)
+#define POOL_FREE(T) POOL_CAT(pool_free_, T)
+#define POOL_CLEAR(T) POOL_CAT(pool_clear_, T)
+#define POOL_SIZE(T) POOL_CAT(pool_size_, T)
+
+#endif
+
+typedef union POOL_SLOT(POOL_ELEMENT)
+{
+  union POOL_SLOT(POOL_ELEMENT)* next;
+  POOL_ELEMENT element;
+} POOL_SLOT(POOL_ELEMENT);
+
+typedef struct
+{
+  Index capacity;
+  Index used;     // slots at or beyond this index have never been handed out
+  Index size;     // number of live elements
+  POOL_SLOT(POOL_ELEMENT)* free;
+  POOL_SLOT(POOL_ELEMENT)* data;
+} POOL_TYPE(POOL_ELEMENT);
+
+static inline Void POOL_INIT(POOL_ELEMENT)(POOL_TYPE(POOL_ELEMENT) * pool, POOL_SLOT(POOL_ELEMENT) * data, Index capacity)
+{
+  pool->capacity = capacity;
+  pool->used = 0;
+  pool->size = 0;
+  pool->free = NULL;
+  pool->data = data;
+}
+
+// Backs the pool with its own virtual allocation.
+static inline Void POOL_CREATE(POOL_ELEMENT)(POOL_TYPE(POOL_ELEMENT) * pool, Index capacity)
+{
+  POOL_SLOT(POOL_ELEMENT)* const data = platform_virtual_alloc(capacity * sizeof(*data));
+  POOL_INIT(POOL_ELEMENT)(pool, data, capacity);
+}
+
+static inline Void POOL_DESTROY(POOL_ELEMENT)(POOL_TYPE(POOL_ELEMENT) * pool)
+{
+  platform_virtual_free(pool->data);
+  POOL_INIT(POOL_ELEMENT)(pool, NULL, 0);
+}
+
+// Returns NULL when the pool is full. The element is not initialized.
+static inline POOL_ELEMENT* POOL_ALLOC(POOL_ELEMENT)(POOL_TYPE(POOL_ELEMENT) * pool)
+{
+  POOL_SLOT(POOL_ELEMENT)* slot = pool->free;
+  if (slot) {
+    pool->free = slot->next;
+  } else if (pool->used < pool->capacity) {
+    slot = &pool->data[pool->used];
+    pool->used += 1;
+  } else {
+    return NULL;
+  }
+  pool->size += 1;
+  return &slot->element;
+}
+
+static inline Void POOL_FREE(POOL_ELEMENT)(POOL_TYPE(POOL_ELEMENT) * pool, POOL_ELEMENT* element)
+{
+  POOL_SLOT(POOL_ELEMENT)* const slot = (POOL_SLOT(POOL_ELEMENT)*) element;
+  ASSERT(slot >= pool->data && slot < pool->data + pool->used);
+  slot->next = pool->free;
+  pool->free = slot;
+  pool->size -= 1;
+}
+
+// Releases every element at once.
+static inline Void POOL_CLEAR(POOL_ELEMENT)(POOL_TYPE(POOL_ELEMENT) * pool)
+{
+  pool->used = 0;
+  pool->size = 0;
+  pool->free = NULL;
+}
+
+static inline Index POOL_SIZE(POOL_ELEMENT)(const POOL_TYPE(POOL_ELEMENT) * pool)
+{
+  return pool->size;
+}
+
+#undef POOL_ELEMENT
@@ -2,33 +2,60 @@
  * GENERIC QUEUE
  *
  * The user should define QUEUE_ELEMENT as the type parameter.
+ *
+ * If QUEUE_POWER_OF_TWO is defined, the capacity must be a power of two and
+ * indices wrap with a mask instead of a division. One slot is always left
+ * empty, so a queue holds at most capacity - 1 elements.
  ******************************************************************************/
 
 #ifndef GENERIC_QUEUE_H
 #define GENERIC_QUEUE_H
 
+#include <string.h>
 #include "prelude.h"
 
 #define QUEUE_CAT(a, ...) QUEUE_CAT_(a, __VA_ARGS__)
 #define QUEUE_CAT_(a, ...) a##__VA_ARGS__
 #define QUEUE_TYPE(T) QUEUE_CAT(Queue, T)
+#define QUEUE_SPAN(T) QUEUE_CAT(QueueSpan, T)
 #define QUEUE_INIT(T) QUEUE_CAT(queue_init_, T)
 #define QUEUE_ENQUEUE(T) QUEUE_CAT(queue_enqueue_, T)
 #define QUEUE_DEQUEUE(T) QUEUE_CAT(queue_dequeue_, T)
+#define QUEUE_ENQUEUE_MANY(T) QUEUE_CAT(queue_enqueue_many_, T)
+#define QUEUE_DEQUEUE_MANY(T) QUEUE_CAT(queue_dequeue_many_, T)
+#define QUEUE_PEEK_SPAN(T) QUEUE_CAT(queue_peek_span_, T)
+#define QUEUE_DISCARD(T) QUEUE_CAT(queue_discard_, T)
 #define QUEUE_LENGTH(T) QUEUE_CAT(queue_length_, T)
+#define QUEUE_COPY_OUT_(T) QUEUE_CAT(queue_copy_out_, T)
+
+#endif
 
+#ifdef QUEUE_POWER_OF_TWO
+#define QUEUE_WRAP_(queue, index) ((index) & ((queue)->capacity - 1))
+#else
+#define QUEUE_WRAP_(queue, index) ((index) % (queue)->capacity)
 #endif
 
 typedef struct
 {
-  S32 capacity;
-  S32 head;
-  S32 tail;
+  Index capacity;
+  Index head;
+  Index tail;
   QUEUE_ELEMENT* data;
 } QUEUE_TYPE(QUEUE_ELEMENT);
 
-static inline Void QUEUE_INIT(QUEUE_ELEMENT)(QUEUE_TYPE(QUEUE_ELEMENT) * queue, QUEUE_ELEMENT* data, S32 capacity)
+// A run of queued elements, in place in the queue's storage.
+typedef struct
+{
+  const QUEUE_ELEMENT* data;
+  Index length;
+} QUEUE_SPAN(QUEUE_ELEMENT);
+
+static inline Void QUEUE_INIT(QUEUE_ELEMENT)(QUEUE_TYPE(QUEUE_ELEMENT) * queue, QUEUE_ELEMENT* data, Index capacity)
 {
+#ifdef QUEUE_POWER_OF_TWO
+  ASSERT(capacity > 0 && (capacity & (capacity - 1)) == 0);
+#endif
   queue->capacity = capacity;
   queue->head = 0;
   queue->tail = 0;
@@ -37,7 +64,7 @@ static inline Void QUEUE_INIT(QUEUE_ELEMENT)(QUEUE_TYPE(QUEUE_ELEMENT) * queue,
 
 static inline Void QUEUE_ENQUEUE(QUEUE_ELEMENT)(QUEUE_TYPE(QUEUE_ELEMENT) * queue, QUEUE_ELEMENT element)
 {
-  const S32 new_head = (queue->head + 1) % queue->capacity;
+  const Index new_head = QUEUE_WRAP_(queue, queue->head + 1);
   if (new_head != queue->tail) {
     queue->data[queue->head] = element;
     queue->head = new_head;
@@ -48,17 +75,81 @@ static inline QUEUE_ELEMENT QUEUE_DEQUEUE(QUEUE_ELEMENT)(QUEUE_TYPE(QUEUE_ELEMEN
 {
   if (queue->tail != queue->head) {
     const QUEUE_ELEMENT element = queue->data[queue->tail];
-    queue->tail = (queue->tail + 1) % queue->capacity;
+    queue->tail = QUEUE_WRAP_(queue, queue->tail + 1);
     return element;
   } else {
     return sentinel;
   }
 }
 
-static inline S32 QUEUE_LENGTH(QUEUE_ELEMENT)(const QUEUE_TYPE(QUEUE_ELEMENT) * queue)
+static inline Index QUEUE_LENGTH(QUEUE_ELEMENT)(const QUEUE_TYPE(QUEUE_ELEMENT) * queue)
 {
-  const S32 d = queue->head - queue->tail;
+  const Index d = queue->head - queue->tail;
   return d >= 0 ? d : d + queue->capacity;
 }
 
+// Enqueues as many of the elements as fit, with at most two copies, and
+// returns the number enqueued.
+static inline Index QUEUE_ENQUEUE_MANY(QUEUE_ELEMENT)(
+    QUEUE_TYPE(QUEUE_ELEMENT) * queue,
+    const QUEUE_ELEMENT* elements,
+    Index count)
+{
+  const Index space = queue->capacity - 1 - QUEUE_LENGTH(QUEUE_ELEMENT)(queue);
+  const Index n = MIN(count, space);
+  const Index first = MIN(n, queue->capacity - queue->head);
+  memcpy(queue->data + queue->head, elements, first * sizeof(*elements));
+  memcpy(queue->data, elements + first, (n - first) * sizeof(*elements));
+  queue->head = QUEUE_WRAP_(queue, queue->head + n);
+  return n;
+}
+
+static inline Index QUEUE_COPY_OUT_(QUEUE_ELEMENT)(
+    const QUEUE_TYPE(QUEUE_ELEMENT) * queue,
+    QUEUE_ELEMENT* out,
+    Index count)
+{
+  const Index n = MIN(count, QUEUE_LENGTH(QUEUE_ELEMENT)(queue));
+  const Index first = MIN(n, queue->capacity - queue->tail);
+  memcpy(out, queue->data + queue->tail, first * sizeof(*out));
+  memcpy(out + first, queue->data, (n - first) * sizeof(*out));
+  return n;
+}
+
+// Dequeues up to `count` elements, with at most two copies, and returns the
+// number dequeued.
+static inline Index QUEUE_DEQUEUE_MANY(QUEUE_ELEMENT)(QUEUE_TYPE(QUEUE_ELEMENT) * queue, QUEUE_ELEMENT* out, Index count)
+{
+  const Index n = QUEUE_COPY_OUT_(QUEUE_ELEMENT)(queue, out, count);
+  queue->tail = QUEUE_WRAP_(queue, queue->tail + n);
+  return n;
+}
+
+// Views the queued elements without copying them, oldest first, as two
+// spans of the storage. The second is empty unless the elements wrap around.
+// Returns the total length. The spans are valid until the queue is modified.
+static inline Index QUEUE_PEEK_SPAN(QUEUE_ELEMENT)(
+    const QUEUE_TYPE(QUEUE_ELEMENT) * queue,
+    QUEUE_SPAN(QUEUE_ELEMENT) spans[2])
+{
+  const Index n = QUEUE_LENGTH(QUEUE_ELEMENT)(queue);
+  const Index first = MIN(n, queue->capacity - queue->tail);
+  spans[0].data = queue->data + queue->tail;
+  spans[0].length = first;
+  spans[1].data = queue->data;
+  spans[1].length = n - first;
+  return n;
+}
+
+// Drops up to `count` of the oldest elements, such as those consumed through
+// QUEUE_PEEK_SPAN, and returns the number dropped.
+static inline Index QUEUE_DISCARD(QUEUE_ELEMENT)(QUEUE_TYPE(QUEUE_ELEMENT) * queue, Index count)
+{
+  const Index n = MIN(count, QUEUE_LENGTH(QUEUE_ELEMENT)(queue));
+  queue->tail = QUEUE_WRAP_(queue, queue->tail + n);
+  return n;
+}
+
+#undef QUEUE_WRAP_
 #undef QUEUE_ELEMENT
+#undef QUEUE_POWER_OF_TWO
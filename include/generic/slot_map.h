@@ -0,0 +1,167 @@
+/*******************************************************************************
+ * GENERIC SLOT MAP
+ *
+ * The user should define SLOT_MAP_ELEMENT as the type parameter. Including the
+ * header without it only declares SlotHandle.
+ *
+ * Elements are kept packed in a dense array, so iterating over them is a
+ * linear walk over data[0, length). Handles refer to them indirectly through
+ * a slot, which records the element's dense index and a generation. Removing
+ * an element bumps its slot's generation, so stale handles are detected rather
+ * than aliasing a later element. Insert, remove and lookup are O(1).
+ *
+ * Generations start at 1, so a zeroed handle never refers to an element.
+ ******************************************************************************/
+
+#ifndef GENERIC_SLOT_MAP_H
+#define GENERIC_SLOT_MAP_H
+
+#include "prelude.h"
+#include "memory.h"
+
+typedef struct {
+  U32 index;
+  U32 generation;
+} SlotHandle;
+
+typedef struct {
+  U32 generation;
+  U32 value;      // dense index while live, next free slot otherwise
+} SlotMapSlot;
+
+#define SLOT_MAP_NONE 0xFFFFFFFFu
+
+static inline Bool slot_handle_equal(SlotHandle a, SlotHandle b)
+{
+  return a.index == b.index && a.generation == b.generation;
+}
+
+#define SLOT_MAP_CAT(a, ...) SLOT_MAP_CAT_(a, __VA_ARGS__)
+#define SLOT_MAP_CAT_(a, ...) a##__VA_ARGS__
+#define SLOT_MAP_TYPE(T) SLOT_MAP_CAT(SlotMap, T)
+#define SLOT_MAP_CREATE(T) SLOT_MAP_CAT(slot_map_create_, T)
+#define SLOT_MAP_DESTROY(T) SLOT_MAP_CAT(slot_map_destroy_, T)
+#define SLOT_MAP_INSERT(T) SLOT_MAP_CAT(slot_map_insert_, T)
+#define SLOT_MAP_REMOVE(T) SLOT_MAP_CAT(slot_map_remove_, T)
+#define SLOT_MAP_GET(T) SLOT_MAP_CAT(slot_map_get_, T)
+#define SLOT_MAP_CLEAR(T) SLOT_MAP_CAT(slot_map_clear_, T)
+#define SLOT_MAP_LENGTH(T) SLOT_MAP_CAT(slot_map_length_, T)
+
+#endif
+
+#ifdef SLOT_MAP_ELEMENT
+
+typedef struct
+{
+  Index capacity;
+  Index length;
+  Index used;                 // slots at or beyond this index have never been handed out
+  U32 free;                   // first free slot, or SLOT_MAP_NONE
+  SLOT_MAP_ELEMENT* data;     // dense elements
+  U32* owners;                // slot of each dense element
+  SlotMapSlot* slots;
+} SLOT_MAP_TYPE(SLOT_MAP_ELEMENT);
+
+// Backs the map with one virtual allocation for all three arrays.
+static inline Void SLOT_MAP_CREATE(SLOT_MAP_ELEMENT)(SLOT_MAP_TYPE(SLOT_MAP_ELEMENT) * map, Index capacity)
+{
+  ASSERT(capacity > 0 && capacity < SLOT_MAP_NONE);
+  const Size data_size = ((Size) capacity * sizeof(SLOT_MAP_ELEMENT) + 7) & ~(Size) 7;
+  const Size slots_size = (Size) capacity * sizeof(SlotMapSlot);
+  const Size owners_size = (Size) capacity * sizeof(U32);
+  Byte* const base = platform_virtual_alloc(data_size + slots_size + owners_size);
+  map->capacity = capacity;
+  map->length = 0;
+  map->used = 0;
+  map->free = SLOT_MAP_NONE;
+  map->data = (SLOT_MAP_ELEMENT*) base;
+  map->slots = (SlotMapSlot*) (base + data_size);
+  map->owners = (U32*) (base + data_size + slots_size);
+}
+
+static inline Void SLOT_MAP_DESTROY(SLOT_MAP_ELEMENT)(SLOT_MAP_TYPE(SLOT_MAP_ELEMENT) * map)
+{
+  platform_virtual_free(map->data);
+  map->capacity = 0;
+  map->length = 0;
+  map->used = 0;
+  map->free = SLOT_MAP_NONE;
+  map->data = NULL;
+  map->slots = NULL;
+  map->owners = NULL;
+}
+
+// Returns a zeroed handle when the map is full.
+static inline SlotHandle SLOT_MAP_INSERT(SLOT_MAP_ELEMENT)(SLOT_MAP_TYPE(SLOT_MAP_ELEMENT) * map, SLOT_MAP_ELEMENT element)
+{
+  U32 index = map->free;
+  if (index != SLOT_MAP_NONE) {
+    map->free = map->slots[index].value;
+  } else if (map->used < map->capacity) {
+    index = (U32) map->used;
+    map->slots[index].generation = 1;
+    map->used += 1;
+  } else {
+    return (SlotHandle) {0};
+  }
+
+  SlotMapSlot* const slot = &map->slots[index];
+  slot->value = (U32) map->length;
+  map->data[map->length] = element;
+  map->owners[map->length] = index;
+  map->length += 1;
+  return (SlotHandle) { index, slot->generation };
+}
+
+// Returns NULL if the handle is stale. The pointer is invalidated by the next
+// removal, which may move another element into its place.
+static inline SLOT_MAP_ELEMENT* SLOT_MAP_GET(SLOT_MAP_ELEMENT)(const SLOT_MAP_TYPE(SLOT_MAP_ELEMENT) * map, SlotHandle handle)
+{
+  if (handle.index >= map->used || map->slots[handle.index].generation != handle.generation) {
+    return NULL;
+  }
+  return &map->data[map->slots[handle.index].value];
+}
+
+// Returns false if the handle is stale.
+static inline Bool SLOT_MAP_REMOVE(SLOT_MAP_ELEMENT)(SLOT_MAP_TYPE(SLOT_MAP_ELEMENT) * map, SlotHandle handle)
+{
+  if (handle.index >= map->used || map->slots[handle.index].generation != handle.generation) {
+    return false;
+  }
+
+  // move the last element into the hole
+  SlotMapSlot* const slot = &map->slots[handle.index];
+  const U32 dense = slot->value;
+  const Index last = map->length - 1;
+  map->data[dense] = map->data[last];
+  map->owners[dense] = map->owners[last];
+  map->slots[map->owners[dense]].value = dense;
+  map->length = last;
+
+  slot->generation += 1;
+  if (slot->generation == 0) {
+    slot->generation = 1;
+  }
+  slot->value = map->free;
+  map->free = handle.index;
+  return true;
+}
+
+// Removes every element. Outstanding handles stay stale.
+static inline Void SLOT_MAP_CLEAR(SLOT_MAP_ELEMENT)(SLOT_MAP_TYPE(SLOT_MAP_ELEMENT) * map)
+{
+  while (map->length > 0) {
+    const U32 index = map->owners[map->length - 1];
+    SLOT_MAP_REMOVE(SLOT_MAP_ELEMENT)(map, (SlotHandle) { index, map->slots[index].generation });
+  }
+}
+
+static inline Index SLOT_MAP_LENGTH(SLOT_MAP_ELEMENT)(const SLOT_MAP_TYPE(SLOT_MAP_ELEMENT) * map)
+{
+  return map->length;
+}
+
+#undef SLOT_MAP_ELEMENT
+
+#endif
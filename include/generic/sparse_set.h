@@ -0,0 +1,130 @@
+/*******************************************************************************
+ * GENERIC SPARSE SET
+ *
+ * The user should define SPARSE_SET_ELEMENT as the type parameter.
+ *
+ * A set of integer keys below a fixed universe, each with an element. The
+ * sparse array maps a key to its position in the dense arrays, and the dense
+ * arrays hold the keys and elements packed, so membership is O(1) and
+ * iteration only visits members:
+ *
+ *   for (Index i = 0; i < set.length; i++) { set.keys[i], set.data[i] }
+ *
+ * Removal moves the last member into the hole, so it reorders the members.
+ ******************************************************************************/
+
+#ifndef GENERIC_SPARSE_SET_H
+#define GENERIC_SPARSE_SET_H
+
+#include "prelude.h"
+#include "memory.h"
+
+#define SPARSE_SET_CAT(a, ...) SPARSE_SET_CAT_(a, __VA_ARGS__)
+#define SPARSE_SET_CAT_(a, ...) a##__VA_ARGS__
+#define SPARSE_SET_TYPE(T) SPARSE_SET_CAT(SparseSet, T)
+#define SPARSE_SET_CREATE(T) SPARSE_SET_CAT(sparse_set_create_, T)
+#define SPARSE_SET_DESTROY(T) SPARSE_SET_CAT(sparse_set_destroy_, T)
+#define SPARSE_SET_CONTAINS(T) SPARSE_SET_CAT(sparse_set_contains_, T)
+#define SPARSE_SET_GET(T) SPARSE_SET_CAT(sparse_set_get_, T)
+#define SPARSE_SET_INSERT(T) SPARSE_SET_CAT(sparse_set_insert_, T)
+#define SPARSE_SET_REMOVE(T) SPARSE_SET_CAT(sparse_set_remove_, T)
+#define SPARSE_SET_CLEAR(T) SPARSE_SET_CAT(sparse_set_clear_, T)
+#define SPARSE_SET_LENGTH(T) SPARSE_SET_CAT(sparse_set_length_, T)
+
+#endif
+
+typedef struct
+{
+  Index universe;
+  Index capacity;
+  Index length;
+  U32* sparse;                  // may hold stale positions for non-members
+  U32* keys;
+  SPARSE_SET_ELEMENT* data;
+} SPARSE_SET_TYPE(SPARSE_SET_ELEMENT);
+
+// Backs the set with one virtual allocation. Keys must be below `universe`,
+// and at most `capacity` may be members at once.
+static inline Void SPARSE_SET_CREATE(SPARSE_SET_ELEMENT)(SPARSE_SET_TYPE(SPARSE_SET_ELEMENT) * set, Index universe, Index capacity)
+{
+  const Size data_size = ((Size) capacity * sizeof(SPARSE_SET_ELEMENT) + 7) & ~(Size) 7;
+  const Size keys_size = ((Size) capacity * sizeof(U32) + 7) & ~(Size) 7;
+  const Size sparse_size = (Size) universe * sizeof(U32);
+  Byte* const base = platform_virtual_alloc(data_size + keys_size + sparse_size);
+  set->universe = universe;
+  set->capacity = capacity;
+  set->length = 0;
+  set->data = (SPARSE_SET_ELEMENT*) base;
+  set->keys = (U32*) (base + data_size);
+  set->sparse = (U32*) ((Byte*) set->keys + keys_size);
+}
+
+static inline Void SPARSE_SET_DESTROY(SPARSE_SET_ELEMENT)(SPARSE_SET_TYPE(SPARSE_SET_ELEMENT) * set)
+{
+  platform_virtual_free(set->data);
+  set->universe = 0;
+  set->capacity = 0;
+  set->length = 0;
+  set->sparse = NULL;
+  set->keys = NULL;
+  set->data = NULL;
+}
+
+static inline Bool SPARSE_SET_CONTAINS(SPARSE_SET_ELEMENT)(const SPARSE_SET_TYPE(SPARSE_SET_ELEMENT) * set, U32 key)
+{
+  ASSERT(key < set->universe);
+  const U32 position = set->sparse[key];
+  return position < set->length && set->keys[position] == key;
+}
+
+// Returns NULL for a non-member.
+static inline SPARSE_SET_ELEMENT* SPARSE_SET_GET(SPARSE_SET_ELEMENT)(const SPARSE_SET_TYPE(SPARSE_SET_ELEMENT) * set, U32 key)
+{
+  return SPARSE_SET_CONTAINS(SPARSE_SET_ELEMENT)(set, key) ? &set->data[set->sparse[key]] : NULL;
+}
+
+// Inserts or overwrites. Returns false if the set is full.
+static inline Bool SPARSE_SET_INSERT(SPARSE_SET_ELEMENT)(SPARSE_SET_TYPE(SPARSE_SET_ELEMENT) * set, U32 key, SPARSE_SET_ELEMENT element)
+{
+  if (SPARSE_SET_CONTAINS(SPARSE_SET_ELEMENT)(set, key)) {
+    set->data[set->sparse[key]] = element;
+    return true;
+  }
+  if (set->length == set->capacity) {
+    return false;
+  }
+  set->sparse[key] = (U32) set->length;
+  set->keys[set->length] = key;
+  set->data[set->length] = element;
+  set->length += 1;
+  return true;
+}
+
+// Returns false for a non-member.
+static inline Bool SPARSE_SET_REMOVE(SPARSE_SET_ELEMENT)(SPARSE_SET_TYPE(SPARSE_SET_ELEMENT) * set, U32 key)
+{
+  if (!SPARSE_SET_CONTAINS(SPARSE_SET_ELEMENT)(set, key)) {
+    return false;
+  }
+  const U32 position = set->sparse[key];
+  const Index last = set->length - 1;
+  const U32 moved = set->keys[last];
+  set->keys[position] = moved;
+  set->data[position] = set->data[last];
+  set->sparse[moved] = position;
+  set->length = last;
+  return true;
+}
+
+// O(1), since stale sparse entries are never trusted.
+static inline Void SPARSE_SET_CLEAR(SPARSE_SET_ELEMENT)(SPARSE_SET_TYPE(SPARSE_SET_ELEMENT) * set)
+{
+  set->length = 0;
+}
+
+static inline Index SPARSE_SET_LENGTH(SPARSE_SET_ELEMENT)(const SPARSE_SET_TYPE(SPARSE_SET_ELEMENT) * set)
+{
+  return set->length;
+}
+
+#undef SPARSE_SET_ELEMENT
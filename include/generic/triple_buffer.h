@@ -0,0 +1,115 @@
+/*******************************************************************************
+ * GENERIC TRIPLE BUFFER
+ *
+ * The user should define TRIPLE_BUFFER_ELEMENT as the type parameter.
+ *
+ * Passes snapshots from exactly one writer thread to exactly one reader thread
+ * without locks. The writer fills its back slot in place and publishes it by
+ * swapping it with the middle slot. The reader swaps the middle slot with its
+ * front slot only when the writer has published since the last swap. Neither
+ * side ever waits, and the reader always sees the newest complete snapshot.
+ *
+ * The back slot handed out after a publish holds an older snapshot, so the
+ * writer should rewrite the whole element rather than update it.
+ ******************************************************************************/
+
+#ifndef GENERIC_TRIPLE_BUFFER_H
+#define GENERIC_TRIPLE_BUFFER_H
+
+#include <stdatomic.h>
+#include "prelude.h"
+
+#define TRIPLE_BUFFER_CAT(a, ...) TRIPLE_BUFFER_CAT_(a, __VA_ARGS__)
+#define TRIPLE_BUFFER_CAT_(a, ...) a##__VA_ARGS__
+#define TRIPLE_BUFFER_TYPE(T) TRIPLE_BUFFER_CAT(TripleBuffer, T)
+#define TRIPLE_BUFFER_INIT(T) TRIPLE_BUFFER_CAT(triple_buffer_init_, T)
+#define TRIPLE_BUFFER_WRITE(T) TRIPLE_BUFFER_CAT(triple_buffer_write_, T)
+#define TRIPLE_BUFFER_PUBLISH(T) TRIPLE_BUFFER_CAT(triple_buffer_publish_, T)
+#define TRIPLE_BUFFER_UPDATE(T) TRIPLE_BUFFER_CAT(triple_buffer_update_, T)
+#define TRIPLE_BUFFER_READ(T) TRIPLE_BUFFER_CAT(triple_buffer_read_, T)
+
+// set in the middle index when it holds a snapshot the reader has not seen
+#define TRIPLE_BUFFER_FRESH 4u
+#define TRIPLE_BUFFER_SLOT 3u
+
+#endif
+
+#ifdef TRIPLE_BUFFER_INTERFACE
+
+typedef struct TRIPLE_BUFFER_TYPE(TRIPLE_BUFFER_ELEMENT) {
+
+  // each slot on its own cache lines, since the sides write different slots
+  struct {
+    _Alignas(CACHE_LINE) TRIPLE_BUFFER_ELEMENT value;
+  } slots[3];
+
+  // shared
+  _Alignas(CACHE_LINE) _Atomic U32 middle;
+
+  // owned by the writer
+  _Alignas(CACHE_LINE) U32 back;
+
+  // owned by the reader
+  _Alignas(CACHE_LINE) U32 front;
+
+} TRIPLE_BUFFER_TYPE(TRIPLE_BUFFER_ELEMENT);
+
+#endif
+
+#ifdef TRIPLE_BUFFER_IMPLEMENTATION
+
+// All three slots start with `initial`, so the reader has a valid snapshot
+// before the first publish.
+static inline Void TRIPLE_BUFFER_INIT(TRIPLE_BUFFER_ELEMENT)(
+    TRIPLE_BUFFER_TYPE(TRIPLE_BUFFER_ELEMENT)* buffer,
+    TRIPLE_BUFFER_ELEMENT initial)
+{
+  for (S32 i = 0; i < 3; i++) {
+    buffer->slots[i].value = initial;
+  }
+  buffer->back = 0;
+  atomic_init(&buffer->middle, 1);
+  buffer->front = 2;
+}
+
+// Writer only. The slot to fill before the next publish.
+static inline TRIPLE_BUFFER_ELEMENT* TRIPLE_BUFFER_WRITE(TRIPLE_BUFFER_ELEMENT)(
+    TRIPLE_BUFFER_TYPE(TRIPLE_BUFFER_ELEMENT)* buffer)
+{
+  return &buffer->slots[buffer->back].value;
+}
+
+// Writer only. Makes the written slot the newest snapshot.
+static inline Void TRIPLE_BUFFER_PUBLISH(TRIPLE_BUFFER_ELEMENT)(
+    TRIPLE_BUFFER_TYPE(TRIPLE_BUFFER_ELEMENT)* buffer)
+{
+  const U32 previous = atomic_exchange_explicit(
+      &buffer->middle, buffer->back | TRIPLE_BUFFER_FRESH, memory_order_acq_rel);
+  buffer->back = previous & TRIPLE_BUFFER_SLOT;
+}
+
+// Reader only. Takes the newest snapshot if there is one, and returns whether
+// the front slot changed.
+static inline Bool TRIPLE_BUFFER_UPDATE(TRIPLE_BUFFER_ELEMENT)(
+    TRIPLE_BUFFER_TYPE(TRIPLE_BUFFER_ELEMENT)* buffer)
+{
+  if ((atomic_load_explicit(&buffer->middle, memory_order_relaxed) & TRIPLE_BUFFER_FRESH) == 0) {
+    return false;
+  }
+  const U32 previous = atomic_exchange_explicit(&buffer->middle, buffer->front, memory_order_acq_rel);
+  buffer->front = previous & TRIPLE_BUFFER_SLOT;
+  return true;
+}
+
+// Reader only. The snapshot taken by the last update, valid until the next.
+static inline const TRIPLE_BUFFER_ELEMENT* TRIPLE_BUFFER_READ(TRIPLE_BUFFER_ELEMENT)(
+    const TRIPLE_BUFFER_TYPE(TRIPLE_BUFFER_ELEMENT)* buffer)
+{
+  return &buffer->slots[buffer->front].value;
+}
+
+#endif
+
+#undef TRIPLE_BUFFER_INTERFACE
+#undef TRIPLE_BUFFER_IMPLEMENTATION
+#undef TRIPLE_BUFFER_ELEMENT
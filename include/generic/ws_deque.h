@@ -0,0 +1,202 @@
+/*******************************************************************************
+ * GENERIC WORK STEALING DEQUE
+ *
+ * The user should define WS_DEQUE_ELEMENT as the type parameter. Elements are
+ * stored as atomics, so they should be pointers or integers that the target
+ * can load and store without a lock.
+ *
+ * A Chase-Lev deque, with the C11 memory orderings from Le, Pop, Cohen and
+ * Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak Memory
+ * Models". The owning thread pushes and pops at the bottom, and any other
+ * thread may steal from the top. The owner only synchronizes with thieves
+ * when the deque holds a single element.
+ *
+ * The circular array doubles when full. Thieves may still be reading an old
+ * array, so old arrays are kept until the deque is destroyed.
+ ******************************************************************************/
+
+#ifndef GENERIC_WS_DEQUE_H
+#define GENERIC_WS_DEQUE_H
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include "prelude.h"
+
+#define WS_DEQUE_CAT(a, ...) WS_DEQUE_CAT_(a, __VA_ARGS__)
+#define WS_DEQUE_CAT_(a, ...) a##__VA_ARGS__
+#define WS_DEQUE_TYPE(T) WS_DEQUE_CAT(WsDeque, T)
+#define WS_DEQUE_ARRAY_TYPE(T) WS_DEQUE_CAT(WsDequeArray, T)
+#define WS_DEQUE_INIT(T) WS_DEQUE_CAT(ws_deque_init_, T)
+#define WS_DEQUE_DESTROY(T) WS_DEQUE_CAT(ws_deque_destroy_, T)
+#define WS_DEQUE_PUSH(T) WS_DEQUE_CAT(ws_deque_push_, T)
+#define WS_DEQUE_POP(T) WS_DEQUE_CAT(ws_deque_pop_, T)
+#define WS_DEQUE_STEAL(T) WS_DEQUE_CAT(ws_deque_steal_, T)
+#define WS_DEQUE_LENGTH(T) WS_DEQUE_CAT(ws_deque_length_, T)
+#define WS_DEQUE_ARRAY_CREATE_(T) WS_DEQUE_CAT(ws_deque_array_create_, T)
+#define WS_DEQUE_GROW_(T) WS_DEQUE_CAT(ws_deque_grow_, T)
+
+#endif
+
+#ifdef WS_DEQUE_INTERFACE
+
+typedef struct WS_DEQUE_ARRAY_TYPE(WS_DEQUE_ELEMENT) {
+  Index mask;
+  struct WS_DEQUE_ARRAY_TYPE(WS_DEQUE_ELEMENT) * retired;
+  _Atomic(WS_DEQUE_ELEMENT) elements[];
+} WS_DEQUE_ARRAY_TYPE(WS_DEQUE_ELEMENT);
+
+typedef struct WS_DEQUE_TYPE(WS_DEQUE_ELEMENT) {
+
+  // written by thieves
+  _Alignas(CACHE_LINE) _Atomic Index top;
+
+  // written by the owner
+  _Alignas(CACHE_LINE) _Atomic Index bottom;
+  _Atomic(WS_DEQUE_ARRAY_TYPE(WS_DEQUE_ELEMENT)*) array;
+
+} WS_DEQUE_TYPE(WS_DEQUE_ELEMENT);
+
+#endif
+
+#ifdef WS_DEQUE_IMPLEMENTATION
+
+static inline WS_DEQUE_ARRAY_TYPE(WS_DEQUE_ELEMENT)* WS_DEQUE_ARRAY_CREATE_(WS_DEQUE_ELEMENT)(Index capacity)
+{
+  WS_DEQUE_ARRAY_TYPE(WS_DEQUE_ELEMENT)* const array =
+      malloc(sizeof(*array) + (Size) capacity * sizeof(array->elements[0]));
+  if (array != NULL) {
+    array->mask = capacity - 1;
+    array->retired = NULL;
+  }
+  return array;
+}
+
+// The capacity must be a power of two. Returns false if out of memory.
+static inline Bool WS_DEQUE_INIT(WS_DEQUE_ELEMENT)(WS_DEQUE_TYPE(WS_DEQUE_ELEMENT)* deque, Index capacity)
+{
+  ASSERT(capacity > 0 && (capacity & (capacity - 1)) == 0);
+  WS_DEQUE_ARRAY_TYPE(WS_DEQUE_ELEMENT)* const array = WS_DEQUE_ARRAY_CREATE_(WS_DEQUE_ELEMENT)(capacity);
+  if (array == NULL) {
+    return false;
+  }
+  atomic_init(&deque->top, 0);
+  atomic_init(&deque->bottom, 0);
+  atomic_init(&deque->array, array);
+  return true;
+}
+
+// No other thread may be using the deque.
+static inline Void WS_DEQUE_DESTROY(WS_DEQUE_ELEMENT)(WS_DEQUE_TYPE(WS_DEQUE_ELEMENT)* deque)
+{
+  WS_DEQUE_ARRAY_TYPE(WS_DEQUE_ELEMENT)* array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+  while (array != NULL) {
+    WS_DEQUE_ARRAY_TYPE(WS_DEQUE_ELEMENT)* const retired = array->retired;
+    free(array);
+    array = retired;
+  }
+  atomic_store_explicit(&deque->array, NULL, memory_order_relaxed);
+}
+
+static inline WS_DEQUE_ARRAY_TYPE(WS_DEQUE_ELEMENT)* WS_DEQUE_GROW_(WS_DEQUE_ELEMENT)(
+    WS_DEQUE_TYPE(WS_DEQUE_ELEMENT)* deque,
+    WS_DEQUE_ARRAY_TYPE(WS_DEQUE_ELEMENT)* array,
+    Index top,
+    Index bottom)
+{
+  WS_DEQUE_ARRAY_TYPE(WS_DEQUE_ELEMENT)* const grown =
+      WS_DEQUE_ARRAY_CREATE_(WS_DEQUE_ELEMENT)(2 * (array->mask + 1));
+  if (grown == NULL) {
+    return NULL;
+  }
+  for (Index i = top; i < bottom; i++) {
+    const WS_DEQUE_ELEMENT element = atomic_load_explicit(&array->elements[i & array->mask], memory_order_relaxed);
+    atomic_store_explicit(&grown->elements[i & grown->mask], element, memory_order_relaxed);
+  }
+  grown->retired = array;
+  atomic_store_explicit(&deque->array, grown, memory_order_release);
+  return grown;
+}
+
+// Owner only. Returns false if the deque is full and could not grow.
+static inline Bool WS_DEQUE_PUSH(WS_DEQUE_ELEMENT)(WS_DEQUE_TYPE(WS_DEQUE_ELEMENT)* deque, WS_DEQUE_ELEMENT element)
+{
+  const Index bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+  const Index top = atomic_load_explicit(&deque->top, memory_order_acquire);
+  WS_DEQUE_ARRAY_TYPE(WS_DEQUE_ELEMENT)* array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+  if (bottom - top > array->mask) {
+    array = WS_DEQUE_GROW_(WS_DEQUE_ELEMENT)(deque, array, top, bottom);
+    if (array == NULL) {
+      return false;
+    }
+  }
+  atomic_store_explicit(&array->elements[bottom & array->mask], element, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+  return true;
+}
+
+// Owner only. Takes the most recently pushed element, or returns the sentinel
+// if the deque is empty.
+static inline WS_DEQUE_ELEMENT WS_DEQUE_POP(WS_DEQUE_ELEMENT)(
+    WS_DEQUE_TYPE(WS_DEQUE_ELEMENT)* deque,
+    WS_DEQUE_ELEMENT sentinel)
+{
+  const Index bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+  WS_DEQUE_ARRAY_TYPE(WS_DEQUE_ELEMENT)* const array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+  atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  Index top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+  if (top > bottom) {
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return sentinel;
+  }
+
+  WS_DEQUE_ELEMENT element = atomic_load_explicit(&array->elements[bottom & array->mask], memory_order_relaxed);
+  if (top == bottom) {
+    // the last element, which a thief may be taking at the same time
+    if (!atomic_compare_exchange_strong_explicit(
+            &deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed)) {
+      element = sentinel;
+    }
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+  }
+  return element;
+}
+
+// Any thread. Takes the least recently pushed element, or returns the sentinel
+// if the deque is empty or another thread took the element first.
+static inline WS_DEQUE_ELEMENT WS_DEQUE_STEAL(WS_DEQUE_ELEMENT)(
+    WS_DEQUE_TYPE(WS_DEQUE_ELEMENT)* deque,
+    WS_DEQUE_ELEMENT sentinel)
+{
+  Index top = atomic_load_explicit(&deque->top, memory_order_acquire);
+  atomic_thread_fence(memory_order_seq_cst);
+  const Index bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+  if (top >= bottom) {
+    return sentinel;
+  }
+
+  // consume in the paper; acquire is what compilers implement it as anyway
+  WS_DEQUE_ARRAY_TYPE(WS_DEQUE_ELEMENT)* const array = atomic_load_explicit(&deque->array, memory_order_acquire);
+  const WS_DEQUE_ELEMENT element = atomic_load_explicit(&array->elements[top & array->mask], memory_order_relaxed);
+  if (!atomic_compare_exchange_strong_explicit(
+          &deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed)) {
+    return sentinel;
+  }
+  return element;
+}
+
+// A snapshot when called by a thief.
+static inline Index WS_DEQUE_LENGTH(WS_DEQUE_ELEMENT)(WS_DEQUE_TYPE(WS_DEQUE_ELEMENT)* deque)
+{
+  const Index bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+  const Index top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+  return MAX(bottom - top, 0);
+}
+
+#endif
+
+#undef WS_DEQUE_INTERFACE
+#undef WS_DEQUE_IMPLEMENTATION
+#undef WS_DEQUE_ELEMENT
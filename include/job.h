@@ -0,0 +1,106 @@
+/*******************************************************************************
+ * job.h - work-stealing job system
+ *
+ * One worker thread per spare core, plus the main thread, each with its own
+ * deque of pending jobs. Threads run their own jobs newest first, and steal
+ * the oldest jobs from each other when they run out. Idle workers sleep on a
+ * semaphore, and are woken as jobs are submitted.
+ *
+ * Submitting jobs adds to a counter, and each finished job subtracts from it.
+ * Waiting on the counter runs pending jobs on the waiting thread, rather than
+ * blocking it, so jobs may submit and wait on jobs of their own. The optional
+ * fiber backend goes further, and suspends a waiting job entirely.
+ *
+ * Jobs may only be submitted from the thread that called job_init, or the
+ * thread it handed over to, and from the workers. Until job_init is called,
+ * jobs run immediately on the calling thread.
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdatomic.h>
+#include "prelude.h"
+#include "thread.h"
+
+// Each thread recycles the storage for the jobs it submits in a ring of this
+// many entries. A job submitted while its entry is still queued runs
+// immediately on the submitting thread instead.
+#ifndef JOB_RING
+#define JOB_RING 0x1000
+#endif
+
+typedef Void JobFunction(Void* data);
+
+typedef struct Job {
+  JobFunction* function;
+  Void* data;
+} Job;
+
+// Zero initialized counters are ready to use.
+typedef struct JobCounter {
+  _Atomic Index pending;
+} JobCounter;
+
+// Starts `workers` worker threads, each pinned to one core of `affinity`.
+// With zero affinity, workers aren't pinned and go wherever the scheduler
+// puts them. Zero workers starts one for each core in the mask, or each core
+// beyond the calling thread's, and a negative count starts none.
+//
+// With `fibers`, jobs run on a pool of JOB_FIBERS fibers, and a job that
+// waits on a counter parks its fiber instead of blocking its thread. The
+// thread goes on to other jobs, and the fiber resumes, on whichever thread
+// finds it first, once the counter reaches zero. Jobs then must not hold
+// thread-affine state, such as a mutex, across a wait.
+Void job_init(S32 workers, CoreMask affinity, Bool fibers);
+Void job_terminate();
+
+// Hands the main thread's place in the job system to another thread. The
+// main thread detaches, after which it must not submit or wait on jobs, and
+// the new thread attaches. Handing it back the same way before job_terminate
+// is up to the caller.
+Void job_detach();
+Void job_attach();
+
+// The counter may be NULL for jobs that nobody waits on.
+Void job_run(const Job* jobs, Index count, JobCounter* counter);
+Void job_wait(JobCounter* counter);
+
+// Number of threads running jobs, including the main thread.
+S32 job_thread_count();
+
+// Index of the calling thread in [0, job_thread_count()), or -1 for threads
+// outside the job system. The main thread is 0.
+S32 job_thread_index();
+
+// Ranges at or below this many elements run serially when no grain is given.
+#ifndef PARALLEL_SERIAL_THRESHOLD
+#define PARALLEL_SERIAL_THRESHOLD 0x400
+#endif
+
+typedef Void ParallelForFunction(Index begin, Index end, Void* user);
+
+// Folds [begin, end) into the accumulator.
+typedef Void ParallelReduceFunction(Index begin, Index end, Void* accumulator, Void* user);
+
+// Folds the second accumulator into the first.
+typedef Void ParallelCombineFunction(Void* accumulator, const Void* other, Void* user);
+
+// Calls the function over disjoint chunks of [begin, end) on every job
+// thread, and returns once all chunks are done. Chunks start large and shrink
+// as the range runs out, but are never smaller than `grain` elements. Ranges
+// of at most `grain` elements run on the calling thread, as does everything
+// before job_init.
+Void platform_parallel_for(Index begin, Index end, Index grain, ParallelForFunction* function, Void* user);
+
+// Like platform_parallel_for, with each participating thread folding chunks
+// into its own copy of `result`, which must hold the identity on entry. The
+// copies are then combined into `result` on the calling thread.
+Void platform_parallel_reduce(
+    Index begin,
+    Index end,
+    Index grain,
+    Void* result,
+    Index result_size,
+    ParallelReduceFunction* reduce,
+    ParallelCombineFunction* combine,
+    Void* user);
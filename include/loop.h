@@ -2,6 +2,8 @@
 
 #include "prelude.h"
 #include "event.h"
+#include "arena.h"
+#include "thread.h"
 
 typedef struct SystemInfo {
   V2S display;      // primary display resolution
@@ -16,6 +18,36 @@ typedef struct ProgramConfig {
   // set working directory to the parent of the executable
   Bool normalize_working_directory;
 
+  // Address space to reserve for the scratch arenas, or zero for the default.
+  // The audio arena is committed in full up front, so keep it modest.
+  Index video_scratch;
+  Index audio_scratch;
+
+  // Fault in and lock the audio thread's stack and scratch memory before the
+  // stream starts, so early callbacks don't stall on page faults.
+  Bool lock_audio_memory;
+
+  // Worker threads for the job system, which is running by the time
+  // loop_init is called. Zero starts one per spare core, and a negative
+  // count starts none.
+  S32 job_workers;
+
+  // Run jobs on fibers, so that jobs waiting on other jobs park rather than
+  // occupying a thread. See job_init.
+  Bool job_fibers;
+
+  // Cores for the audio thread and the job workers, or zero for any. Keeping
+  // them disjoint stops workers preempting audio callbacks and evicting
+  // their data.
+  CoreMask audio_affinity;
+  CoreMask job_affinity;
+
+  // Run loop_event and loop_video on a simulation thread, which records each
+  // frame into a display list while the main thread submits the previous one
+  // and waits on vsync. Textures must then be loaded and unloaded in loop_init
+  // or loop_terminate, which still run on the main thread. See display_record.
+  Bool pipelined_rendering;
+
 } ProgramConfig;
 
 typedef enum ProgramStatus {
@@ -31,3 +63,11 @@ ProgramStatus loop_video();
 ProgramStatus loop_audio(F32* out, Index frames);
 Void loop_event(const Event* event);
 Void loop_terminate();
+
+// Transient memory owned by the shell. The video arena is reset immediately
+// before each call to loop_video, and the audio arena immediately before each
+// call to loop_audio. Each arena should only be used from its own thread,
+// which for the video arena is the simulation thread under pipelined
+// rendering.
+Arena* platform_video_scratch();
+Arena* platform_audio_scratch();
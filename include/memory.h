@@ -6,5 +6,108 @@
 
 #include "prelude.h"
 
+// Huge page sizes vary by platform and configuration. This is the common case
+// on x86-64, and is used for alignment when huge pages are requested.
+#ifndef MEMORY_HUGE_PAGE_SIZE
+#define MEMORY_HUGE_PAGE_SIZE (2 * MEBI)
+#endif
+
+typedef enum MemoryFlags {
+
+  MEMORY_FLAG_NONE = 0,
+
+  // Advise the system to back the allocation with huge pages where it can.
+  // This is a hint, and is ignored where transparent huge pages are not
+  // supported.
+  MEMORY_FLAG_HUGE_PAGES_TRANSPARENT = 1 << 0,
+
+  // Request explicit huge pages (MAP_HUGETLB, MEM_LARGE_PAGES). These must be
+  // configured by the system administrator, or granted to the user. If they
+  // are not available, we log a warning and fall back to regular pages.
+  MEMORY_FLAG_HUGE_PAGES_EXPLICIT = 1 << 1,
+
+} MemoryFlags;
+
+typedef enum MemoryProtection {
+  MEMORY_PROTECTION_NONE,
+  MEMORY_PROTECTION_READ,
+  MEMORY_PROTECTION_READ_WRITE,
+  MEMORY_PROTECTION_CARDINAL,
+} MemoryProtection;
+
+// Allocations can be tagged with a small integer identifying the subsystem
+// responsible for them. Programs should number their own tags starting from
+// MEMORY_TAG_USER. MEMORY_TAG_NONE is not counted, so untagged memory is
+// never counted, whichever calls allocate it.
+typedef U32 MemoryTag;
+
+#ifndef MEMORY_TAGS
+#define MEMORY_TAGS 32
+#endif
+
+enum {
+  MEMORY_TAG_NONE,
+  MEMORY_TAG_SCRATCH,     // shell scratch arenas
+  MEMORY_TAG_USER,
+};
+
+typedef struct MemoryStats {
+  Index reserved;         // live bytes of address space reserved
+  Index committed;        // live bytes committed
+  Index peak;             // high water mark of committed bytes
+  Index allocations;      // live reservations
+  Index total;            // reservations made since startup
+} MemoryStats;
+
+Size platform_page_size();
+
+// Reserve and commit in one step. These exit the process on failure.
 Void* platform_virtual_alloc(Size size);
+Void* platform_virtual_alloc_flags(Size size, MemoryFlags flags);
 Void platform_virtual_free(Void* pointer);
+
+// Memory for real-time threads. Locked pages are faulted in up front and kept
+// resident, so first access never stalls on the system. platform_locked_alloc
+// exits the process when out of memory; if the system refuses to lock the
+// pages, it logs a warning and returns memory that is merely pre-faulted.
+// platform_memory_lock works on any committed range, such as a thread stack.
+Void* platform_locked_alloc(Size size);
+Void platform_locked_free(Void* pointer, Size size);
+Bool platform_memory_lock(Void* pointer, Size size);
+Void platform_memory_unlock(Void* pointer, Size size);
+
+// Fine-grained control over a range of address space. A reservation consumes
+// no memory until pages within it are committed, and decommitted pages are
+// returned to the system without giving up the address range. Addresses and
+// sizes passed to commit, decommit and protect should be page aligned.
+// Reservations must be released with platform_virtual_release, not
+// platform_virtual_free.
+Void* platform_virtual_reserve(Size size);
+Void platform_virtual_release(Void* pointer, Size size);
+Bool platform_virtual_commit(Void* pointer, Size size);
+Void platform_virtual_decommit(Void* pointer, Size size);
+Bool platform_virtual_protect(Void* pointer, Size size, MemoryProtection protection);
+
+// Maps the same `size` bytes of memory twice, back to back, and returns the
+// start of the 2 * size byte range. A write to either half is visible in the
+// other, so any span of up to `size` bytes starting in the first half is
+// contiguous, regardless of where it wraps. `size` must be a multiple of
+// platform_ring_granularity(). Returns NULL on failure.
+Size platform_ring_granularity();
+Void* platform_ring_alloc(Size size);
+Void platform_ring_free(Void* pointer, Size size);
+
+// Tagged variants of the calls above, which keep per-tag totals. Releasing a
+// tagged reservation takes the bytes still committed within it, which are
+// counted down along with the reservation, so there's no need to decommit
+// first. Totals are in whole pages. The untagged calls are not counted.
+Void* platform_virtual_alloc_tagged(Size size, MemoryTag tag);
+Void platform_virtual_free_tagged(Void* pointer, Size size, MemoryTag tag);
+Void* platform_virtual_reserve_tagged(Size size, MemoryTag tag);
+Void platform_virtual_release_tagged(Void* pointer, Size size, Size committed, MemoryTag tag);
+Bool platform_virtual_commit_tagged(Void* pointer, Size size, MemoryTag tag);
+Void platform_virtual_decommit_tagged(Void* pointer, Size size, MemoryTag tag);
+
+// Reads the totals for a tag. This is a handful of relaxed loads, so it is
+// fine to sample every frame, from any thread.
+MemoryStats platform_memory_stats(MemoryTag tag);
@@ -52,6 +52,9 @@ typedef enum {
 
 #define INDEX_NONE (-1)
 
+// destructive interference size on the platforms we target
+#define CACHE_LINE 64
+
 #define CAT_INTERNAL(a, ...) a ## __VA_ARGS__
 #define CAT(a, ...) CAT_INTERNAL(a, __VA_ARGS__)
 
@@ -0,0 +1,87 @@
+/*******************************************************************************
+ * ring.h - single producer, single consumer byte ring
+ *
+ * The ring is backed by platform_ring_alloc, so the readable and writable
+ * regions are always contiguous in memory, even when they wrap. Producers and
+ * consumers can process spans in place, with no split copies.
+ *
+ * Positions are running totals of bytes written and read, so they never need
+ * to wrap themselves.
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdatomic.h>
+#include "prelude.h"
+#include "memory.h"
+
+typedef struct Ring {
+
+  Byte* data;
+  Index capacity;
+
+  // Each position is only written by one side, so each gets a cache line to
+  // itself to avoid false sharing.
+  _Alignas(CACHE_LINE) _Atomic Index write;
+  _Alignas(CACHE_LINE) _Atomic Index read;
+
+} Ring;
+
+// The capacity is rounded up to the ring granularity.
+static inline Bool ring_create(Ring* ring, Index capacity)
+{
+  const Index g = (Index) platform_ring_granularity();
+  const Index rounded = (capacity + g - 1) / g * g;
+  ring->data = platform_ring_alloc((Size) rounded);
+  ring->capacity = ring->data ? rounded : 0;
+  atomic_init(&ring->write, 0);
+  atomic_init(&ring->read, 0);
+  return ring->data != NULL;
+}
+
+static inline Void ring_destroy(Ring* ring)
+{
+  platform_ring_free(ring->data, (Size) ring->capacity);
+  ring->data = NULL;
+  ring->capacity = 0;
+}
+
+/*******************************************************************************
+ * PRODUCER
+ ******************************************************************************/
+
+// Returns the writable region, and writes its length to `length`.
+static inline Byte* ring_write_span(Ring* ring, Index* length)
+{
+  const Index write = atomic_load_explicit(&ring->write, memory_order_relaxed);
+  const Index read = atomic_load_explicit(&ring->read, memory_order_acquire);
+  *length = ring->capacity - (write - read);
+  return ring->data + write % ring->capacity;
+}
+
+// Publishes `length` bytes written into the span.
+static inline Void ring_commit_write(Ring* ring, Index length)
+{
+  const Index write = atomic_load_explicit(&ring->write, memory_order_relaxed);
+  atomic_store_explicit(&ring->write, write + length, memory_order_release);
+}
+
+/*******************************************************************************
+ * CONSUMER
+ ******************************************************************************/
+
+// Returns the readable region, and writes its length to `length`.
+static inline const Byte* ring_read_span(Ring* ring, Index* length)
+{
+  const Index read = atomic_load_explicit(&ring->read, memory_order_relaxed);
+  const Index write = atomic_load_explicit(&ring->write, memory_order_acquire);
+  *length = write - read;
+  return ring->data + read % ring->capacity;
+}
+
+// Releases `length` bytes of the span back to the producer.
+static inline Void ring_commit_read(Ring* ring, Index length)
+{
+  const Index read = atomic_load_explicit(&ring->read, memory_order_relaxed);
+  atomic_store_explicit(&ring->read, read + length, memory_order_release);
+}
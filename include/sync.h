@@ -0,0 +1,68 @@
+/*******************************************************************************
+ * sync.h - lightweight synchronization
+ *
+ * The primitives here are a word of user memory each, and only enter the
+ * kernel to sleep, or to wake a thread that is known to be sleeping. They are
+ * built on a wait-on-address primitive, which is futex on Linux and
+ * WaitOnAddress on Windows.
+ *
+ * Zero initialized objects are ready to use, except that semaphores start
+ * with a count of zero.
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdatomic.h>
+#include "prelude.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SYNC_PAUSE() _mm_pause()
+#elif defined(__aarch64__)
+#define SYNC_PAUSE() __asm__ __volatile__("yield")
+#else
+#define SYNC_PAUSE() ((Void) 0)
+#endif
+
+// times a contended lock or wait polls before sleeping
+#ifndef SYNC_SPINS
+#define SYNC_SPINS 128
+#endif
+
+// Sleeps while the value at `address` equals `expected`. The comparison and
+// sleep are atomic with respect to wakes. May return spuriously, so callers
+// must check their condition in a loop.
+Void platform_address_wait(_Atomic U32* address, U32 expected);
+Void platform_address_wake_one(_Atomic U32* address);
+Void platform_address_wake_all(_Atomic U32* address);
+
+// A mutex that spins briefly before sleeping. An uncontended lock or unlock is
+// a single atomic operation.
+typedef struct Mutex {
+  _Atomic U32 state;  // 0 unlocked, 1 locked, 2 locked with possible sleepers
+} Mutex;
+
+Void mutex_lock(Mutex* mutex);
+Bool mutex_try_lock(Mutex* mutex);
+Void mutex_unlock(Mutex* mutex);
+
+// An auto-reset event. Signalling releases one waiter, or the next thread to
+// wait if there are none. Signals do not accumulate.
+typedef struct Event {
+  _Atomic U32 signaled;
+  _Atomic U32 sleepers;
+} Event;
+
+Void event_signal(Event* event);
+Void event_wait(Event* event);
+
+// A counting semaphore.
+typedef struct Semaphore {
+  _Atomic U32 count;
+  _Atomic U32 sleepers;
+} Semaphore;
+
+Void semaphore_init(Semaphore* semaphore, S32 count);
+Void semaphore_post(Semaphore* semaphore, S32 count);
+Void semaphore_wait(Semaphore* semaphore);
+Bool semaphore_try_wait(Semaphore* semaphore);
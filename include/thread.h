@@ -0,0 +1,55 @@
+/*******************************************************************************
+ * thread.h - threads
+ ******************************************************************************/
+
+#pragma once
+
+#include "prelude.h"
+
+typedef struct Thread Thread;
+
+typedef Void ThreadEntry(Void* data);
+
+// One bit per logical processor. Zero leaves the affinity unchanged.
+typedef U64 CoreMask;
+
+typedef enum ThreadClass {
+
+  THREAD_CLASS_NORMAL,
+  THREAD_CLASS_BACKGROUND,
+  THREAD_CLASS_HIGH,
+
+  // Real-time scheduling for audio callbacks: MMCSS "Pro Audio" on Windows,
+  // SCHED_FIFO on Linux. Linux requires CAP_SYS_NICE or an RLIMIT_RTPRIO
+  // grant, and falls back to the highest niceness allowed.
+  THREAD_CLASS_AUDIO,
+
+  THREAD_CLASS_CARDINAL,
+
+} ThreadClass;
+
+// Zero initialized configs give an unnamed normal thread on any core.
+typedef struct ThreadConfig {
+  const Char* name;     // shown in debuggers and profilers
+  CoreMask affinity;
+  ThreadClass priority;
+} ThreadConfig;
+
+// The config is applied by the new thread before the entry point runs, and
+// may be NULL. Returns NULL on failure. Every created thread must be joined,
+// which also frees it.
+Thread* platform_thread_create(ThreadEntry* entry, Void* data, const ThreadConfig* config);
+Void platform_thread_join(Thread* thread);
+Void platform_thread_yield();
+
+// These apply to the calling thread, and return false on failure.
+Bool platform_thread_set_name(const Char* name);
+Bool platform_thread_set_affinity(CoreMask affinity);
+Bool platform_thread_set_class(ThreadClass priority);
+
+// The logical processor the calling thread is running on, which may already
+// have changed by the time the caller looks at it.
+S32 platform_thread_current_core();
+
+// Number of logical processors available to the process.
+S32 platform_core_count();
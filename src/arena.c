@@ -0,0 +1,69 @@
+#include <stdlib.h>
+#include "arena.h"
+#include "log.h"
+
+static Index arena_round_up(Index size)
+{
+  const Index g = ARENA_COMMIT_GRANULARITY;
+  return (size + g - 1) / g * g;
+}
+
+Void arena_init(Arena* arena, Index reserve)
+{
+  arena_init_tagged(arena, reserve, MEMORY_TAG_NONE);
+}
+
+Void arena_init_tagged(Arena* arena, Index reserve, MemoryTag tag)
+{
+  const Index reserved = arena_round_up(reserve);
+  Byte* const base = platform_virtual_reserve_tagged((Size) reserved, tag);
+  if (base == NULL) {
+    platform_log_error("failed to reserve arena");
+    exit(EXIT_CODE_FAILURE);
+  }
+  arena->base = base;
+  arena->reserved = reserved;
+  arena->committed = 0;
+  arena->position = 0;
+  arena->tag = tag;
+}
+
+Void arena_release(Arena* arena)
+{
+  platform_virtual_release_tagged(arena->base, (Size) arena->reserved, (Size) arena->committed, arena->tag);
+  arena->base = NULL;
+  arena->reserved = 0;
+  arena->committed = 0;
+  arena->position = 0;
+}
+
+Bool arena_commit(Arena* arena, Index size)
+{
+  if (size <= arena->committed) {
+    return true;
+  }
+  if (size > arena->reserved) {
+    return false;
+  }
+
+  // commit whole granules, without running past the end of the reservation
+  const Index target = MIN(arena_round_up(size), arena->reserved);
+  Byte* const start = arena->base + arena->committed;
+  const Bool status = platform_virtual_commit_tagged(start, (Size) (target - arena->committed), arena->tag);
+  if (status == false) {
+    platform_log_error("failed to commit arena memory");
+    return false;
+  }
+
+  arena->committed = target;
+  return true;
+}
+
+Void arena_decommit(Arena* arena)
+{
+  const Index keep = arena_round_up(arena->position);
+  if (keep < arena->committed) {
+    platform_virtual_decommit_tagged(arena->base + keep, (Size) (arena->committed - keep), arena->tag);
+    arena->committed = keep;
+  }
+}
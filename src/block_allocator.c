@@ -0,0 +1,129 @@
+#include <stdint.h>
+#include "block_allocator.h"
+
+// The header occupies the 16 bytes before each block, padded to 16 on 32-bit
+// targets too. While a block is free, its `next` pointer overlaps the start
+// of the block itself.
+struct BlockHeader {
+  BlockCache* owner;
+  Index size_class;
+  _Alignas(BLOCK_MINIMUM) BlockHeader* next;
+};
+
+#define BLOCK_HEADER_SIZE ((Index) offsetof(BlockHeader, next))
+
+static inline BlockHeader* block_header(Void* pointer)
+{
+  return (BlockHeader*) ((Byte*) pointer - BLOCK_HEADER_SIZE);
+}
+
+static inline Void* block_payload(BlockHeader* header)
+{
+  return (Byte*) header + BLOCK_HEADER_SIZE;
+}
+
+static inline Index block_class(Index size)
+{
+  Index size_class = 0;
+  while ((BLOCK_MINIMUM << size_class) < size) {
+    size_class += 1;
+  }
+  return size_class;
+}
+
+Void block_allocator_init(BlockAllocator* allocator, Void* memory, Index size)
+{
+  // Header and block sizes are multiples of 16, so blocks stay aligned as
+  // long as the region starts aligned.
+  ASSERT(BLOCK_HEADER_SIZE == BLOCK_MINIMUM);
+  ASSERT(((uintptr_t) memory & (BLOCK_MINIMUM - 1)) == 0);
+  allocator->base = memory;
+  allocator->size = size;
+  atomic_init(&allocator->cursor, 0);
+}
+
+Void block_cache_init(BlockCache* cache, BlockAllocator* allocator)
+{
+  cache->allocator = allocator;
+  cache->cursor = NULL;
+  cache->limit = NULL;
+  for (Index i = 0; i < BLOCK_CLASSES; i++) {
+    cache->local[i] = NULL;
+    atomic_init(&cache->remote[i], NULL);
+  }
+}
+
+// Carves a fresh block from the cache's slab, claiming a new slab if needed.
+// Whatever is left of the old slab is abandoned.
+static BlockHeader* block_carve(BlockCache* cache, Index size_class)
+{
+  const Index size = BLOCK_HEADER_SIZE + (BLOCK_MINIMUM << size_class);
+  if (cache->limit - cache->cursor < size) {
+    BlockAllocator* const allocator = cache->allocator;
+    const Index slab = MAX(BLOCK_SLAB, size);
+
+    // The cursor never moves past the end, so failed claims leave it alone.
+    Index offset = atomic_load_explicit(&allocator->cursor, memory_order_relaxed);
+    do {
+      if (offset + slab > allocator->size) {
+        return NULL;
+      }
+    } while (!atomic_compare_exchange_weak_explicit(
+          &allocator->cursor, &offset, offset + slab,
+          memory_order_relaxed, memory_order_relaxed));
+    cache->cursor = allocator->base + offset;
+    cache->limit = cache->cursor + slab;
+  }
+  BlockHeader* const header = (BlockHeader*) cache->cursor;
+  cache->cursor += size;
+  header->owner = cache;
+  header->size_class = size_class;
+  return header;
+}
+
+Void* block_alloc(BlockCache* cache, Index size)
+{
+  const Index size_class = block_class(size);
+  if (size_class >= BLOCK_CLASSES) {
+    return NULL;
+  }
+
+  // collect blocks returned by other threads only when we run dry
+  BlockHeader* header = cache->local[size_class];
+  if (header == NULL) {
+    header = atomic_exchange_explicit(&cache->remote[size_class], NULL, memory_order_acquire);
+  }
+
+  if (header) {
+    cache->local[size_class] = header->next;
+  } else {
+    header = block_carve(cache, size_class);
+  }
+
+  return header ? block_payload(header) : NULL;
+}
+
+Void block_free(BlockCache* cache, Void* pointer)
+{
+  if (pointer == NULL) {
+    return;
+  }
+
+  BlockHeader* const header = block_header(pointer);
+  BlockCache* const owner = header->owner;
+  const Index size_class = header->size_class;
+
+  if (owner == cache) {
+    header->next = cache->local[size_class];
+    cache->local[size_class] = header;
+  } else {
+    // The owner only ever takes the whole list, so there's no ABA hazard.
+    _Atomic(BlockHeader*)* const list = &owner->remote[size_class];
+    BlockHeader* head = atomic_load_explicit(list, memory_order_relaxed);
+    do {
+      header->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(
+          list, &head, header,
+          memory_order_release, memory_order_relaxed));
+  }
+}
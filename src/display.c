@@ -1,5 +1,6 @@
 #include "display.h"
 #include "log.h"
+#include "memory.h"
 #include "glad/gl.h"
 #include "shader/sprite.vert.h"
 #include "shader/sprite.frag.h"
@@ -10,6 +11,25 @@
 #define DISPLAY_SPRITES 0x400
 #endif
 
+#ifndef DISPLAY_TEXTURES
+#define DISPLAY_TEXTURES 0x400
+#endif
+
+#ifdef _MSC_VER
+#define DISPLAY_THREAD_LOCAL __declspec(thread)
+#else
+#define DISPLAY_THREAD_LOCAL _Thread_local
+#endif
+
+// capacity of a recorded command list
+#ifndef DISPLAY_LIST_SPRITES
+#define DISPLAY_LIST_SPRITES 0x4000
+#endif
+
+#ifndef DISPLAY_LIST_COMMANDS
+#define DISPLAY_LIST_COMMANDS 0x400
+#endif
+
 #ifndef DISPLAY_TEXTURE_FILTER
 #define DISPLAY_TEXTURE_FILTER GL_LINEAR
 #endif
@@ -24,6 +44,14 @@
 #define DISPLAY_RENDER_STRIDE 5
 #define DISPLAY_POSTPROCESS_STRIDE 4
 
+typedef struct DisplayTexture {
+  GLuint name;
+  V2S size;
+} DisplayTexture;
+
+#define SLOT_MAP_ELEMENT DisplayTexture
+#include "generic/slot_map.h"
+
 typedef struct {
 
   V2S render_resolution;
@@ -42,8 +70,31 @@ typedef struct {
 
   GLint projection;
 
+  SlotMapDisplayTexture textures;
+
 } DisplayContext;
 
+typedef enum DisplayCommandTag {
+  DISPLAY_COMMAND_BEGIN_FRAME,
+  DISPLAY_COMMAND_END_FRAME,
+  DISPLAY_COMMAND_DRAW,
+} DisplayCommandTag;
+
+typedef struct DisplayCommand {
+  DisplayCommandTag tag;
+  TextureID texture;
+  S32 first;    // sprites of a draw
+  S32 count;
+} DisplayCommand;
+
+struct DisplayList {
+  S32 command_count;
+  S32 sprite_count;
+  Bool overflowed;    // warned about dropped work since recording began
+  DisplayCommand commands[DISPLAY_LIST_COMMANDS];
+  Sprite sprites[DISPLAY_LIST_SPRITES];
+};
+
 typedef struct Vertex {
   F32 x; F32 y; // position
   F32 u; F32 v; // texture coordinates
@@ -57,7 +108,14 @@ typedef struct ShaderSource {
 
 static Sprite display_sprite_buffer[DISPLAY_SPRITES] = {0};
 static Vertex display_vertex_buffer[DISPLAY_VERTICES] = {0};
-static S32 display_sprite_index = 0;
+
+// Drawing state is per thread, so one thread can record a list while the
+// context's thread draws. While set, drawing calls append to this thread's
+// list instead of issuing GL calls.
+static DISPLAY_THREAD_LOCAL S32 display_sprite_index = 0;
+static DISPLAY_THREAD_LOCAL DisplayList* display_recording = NULL;
+static DISPLAY_THREAD_LOCAL TextureID display_recording_texture = {0};
+static DISPLAY_THREAD_LOCAL S32 display_recording_first = 0;
 
 static DisplayContext ctx = {0};
 
@@ -93,6 +151,13 @@ static Void GLAPIENTRY gl_message_callback(
 TextureID display_load_image(const Byte* image, V2S dimensions)
 {
   ASSERT(image);
+  const DisplayTexture texture = { 0, dimensions };
+  const TextureID handle = slot_map_insert_DisplayTexture(&ctx.textures, texture);
+  if (handle.generation == 0) {
+    platform_log_error("Too many textures loaded");
+    return handle;
+  }
+
   GLuint id = 0;
   glGenTextures(1, &id);
   glBindTexture(GL_TEXTURE_2D, id);  
@@ -114,7 +179,25 @@ TextureID display_load_image(const Byte* image, V2S dimensions)
       GL_UNSIGNED_BYTE,   // type of pixel data
       image
       );
-  return id;
+  slot_map_get_DisplayTexture(&ctx.textures, handle)->name = id;
+  return handle;
+}
+
+Void display_unload_image(TextureID texture)
+{
+  const DisplayTexture* const entry = slot_map_get_DisplayTexture(&ctx.textures, texture);
+  if (entry == NULL) {
+    platform_log_warn("Unloading a stale texture");
+    return;
+  }
+  glDeleteTextures(1, &entry->name);
+  slot_map_remove_DisplayTexture(&ctx.textures, texture);
+}
+
+V2S display_texture_size(TextureID texture)
+{
+  const DisplayTexture* const entry = slot_map_get_DisplayTexture(&ctx.textures, texture);
+  return entry ? entry->size : v2s(0, 0);
 }
 
 static GLuint compile_shader(GLenum type, ShaderSource source)
@@ -177,6 +260,7 @@ Void display_init(V2S window, V2S render)
 {
   ctx.window_resolution = window;
   ctx.render_resolution = render;
+  slot_map_create_DisplayTexture(&ctx.textures, DISPLAY_TEXTURES);
 
   glEnable(GL_DEBUG_OUTPUT);
   glDebugMessageCallback(gl_message_callback, 0);
@@ -311,7 +395,27 @@ Void display_init(V2S window, V2S render)
       );
 }
 
-Void display_begin_frame()
+// Warns once per recording, since a full list drops work every call.
+static Void display_list_overflow(DisplayList* list, const Char* what)
+{
+  if (list->overflowed == false) {
+    platform_log_warn("display list is out of %s, dropping the rest", what);
+    list->overflowed = true;
+  }
+}
+
+static Void display_record_command(DisplayCommand command)
+{
+  DisplayList* const list = display_recording;
+  if (list->command_count < DISPLAY_LIST_COMMANDS) {
+    list->commands[list->command_count] = command;
+    list->command_count += 1;
+  } else {
+    display_list_overflow(list, "commands");
+  }
+}
+
+static Void display_execute_begin_frame()
 {
   glBindFramebuffer(GL_FRAMEBUFFER, ctx.fbo);
   glClear(GL_COLOR_BUFFER_BIT);
@@ -322,7 +426,7 @@ Void display_begin_frame()
   glEnable(GL_BLEND);
 }
 
-Void display_end_frame()
+static Void display_execute_end_frame()
 {
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
   glClear(GL_COLOR_BUFFER_BIT);
@@ -335,6 +439,24 @@ Void display_end_frame()
   glDrawArrays(GL_TRIANGLES, 0, 6);
 }
 
+Void display_begin_frame()
+{
+  if (display_recording) {
+    display_record_command((DisplayCommand) { .tag = DISPLAY_COMMAND_BEGIN_FRAME });
+  } else {
+    display_execute_begin_frame();
+  }
+}
+
+Void display_end_frame()
+{
+  if (display_recording) {
+    display_record_command((DisplayCommand) { .tag = DISPLAY_COMMAND_END_FRAME });
+  } else {
+    display_execute_end_frame();
+  }
+}
+
 U32 display_color(U8 r, U8 g, U8 b, U8 a)
 {
   const U32 or = r <<  0;
@@ -364,20 +486,21 @@ U32 display_color_lerp(U32 a, U32 b, F32 t)
   return display_color(or, og, ob, oa);
 }
 
-Void display_begin_draw(TextureID texture)
+static Void display_execute_bind(TextureID texture)
 {
-  glBindTexture(GL_TEXTURE_2D, texture);
-  display_sprite_index = 0;
+  const DisplayTexture* const entry = slot_map_get_DisplayTexture(&ctx.textures, texture);
+  ASSERT(entry);
+  glBindTexture(GL_TEXTURE_2D, entry ? entry->name : 0);
 }
 
-Void display_end_draw()
+static Void display_execute_draw(const Sprite* sprites, S32 count)
 {
   Vertex* const vertices = display_vertex_buffer;
 
-  for (S32 i = 0; i < display_sprite_index; i++) {
+  for (S32 i = 0; i < count; i++) {
 
     const S32 vi = DISPLAY_SPRITE_VERTICES * i;
-    const Sprite* const sprite = &display_sprite_buffer[i];
+    const Sprite* const sprite = &sprites[i];
 
     // top left
     vertices[vi + 0].x = sprite->root.x;
@@ -423,7 +546,7 @@ Void display_end_draw()
 
   }
 
-  const S32 vertex_count = DISPLAY_SPRITE_VERTICES * display_sprite_index;
+  const S32 vertex_count = DISPLAY_SPRITE_VERTICES * count;
   const GLsizeiptr size = vertex_count * sizeof(Vertex);
   glBindBuffer(GL_ARRAY_BUFFER, ctx.render_vbo);
   glBufferData(
@@ -437,6 +560,32 @@ Void display_end_draw()
   glDrawArrays(GL_TRIANGLES, 0, vertex_count);
 }
 
+Void display_begin_draw(TextureID texture)
+{
+  if (display_recording) {
+    display_recording_texture = texture;
+    display_recording_first = display_recording->sprite_count;
+  } else {
+    display_execute_bind(texture);
+  }
+  display_sprite_index = 0;
+}
+
+Void display_end_draw()
+{
+  if (display_recording) {
+    const DisplayCommand command = {
+      .tag = DISPLAY_COMMAND_DRAW,
+      .texture = display_recording_texture,
+      .first = display_recording_first,
+      .count = display_recording->sprite_count - display_recording_first,
+    };
+    display_record_command(command);
+  } else {
+    display_execute_draw(display_sprite_buffer, display_sprite_index);
+  }
+}
+
 Void display_draw_sprite(V2F root, V2F size, U32 color, V2F t1, V2F t2)
 {
   Sprite sprite;
@@ -451,7 +600,17 @@ Void display_draw_sprite(V2F root, V2F size, U32 color, V2F t1, V2F t2)
 Void display_draw_sprite_struct(Sprite sprite)
 {
   if (display_sprite_index < DISPLAY_SPRITES) {
-    display_sprite_buffer[display_sprite_index] = sprite;
+    if (display_recording) {
+      DisplayList* const list = display_recording;
+      if (list->sprite_count == DISPLAY_LIST_SPRITES) {
+        display_list_overflow(list, "sprites");
+        return;
+      }
+      list->sprites[list->sprite_count] = sprite;
+      list->sprite_count += 1;
+    } else {
+      display_sprite_buffer[display_sprite_index] = sprite;
+    }
     display_sprite_index += 1;
   }
 }
@@ -471,3 +630,50 @@ Void display_draw_texture_struct(Sprite sprite)
   sprite.tb = v2f(1.f, 1.f);
   display_draw_sprite_struct(sprite);
 }
+
+/*******************************************************************************
+ * COMMAND LISTS
+ ******************************************************************************/
+
+DisplayList* display_list_create()
+{
+  DisplayList* const list = platform_virtual_alloc(sizeof(DisplayList));
+  if (list == NULL) {
+    platform_log_error("failed to allocate display list");
+  }
+  return list;
+}
+
+Void display_list_destroy(DisplayList* list)
+{
+  platform_virtual_free(list);
+}
+
+Void display_record(DisplayList* list)
+{
+  display_recording = list;
+  if (list) {
+    list->command_count = 0;
+    list->sprite_count = 0;
+    list->overflowed = false;
+  }
+}
+
+Void display_submit(const DisplayList* list)
+{
+  for (S32 i = 0; i < list->command_count; i++) {
+    const DisplayCommand* const command = &list->commands[i];
+    switch (command->tag) {
+      case DISPLAY_COMMAND_BEGIN_FRAME:
+        display_execute_begin_frame();
+        break;
+      case DISPLAY_COMMAND_END_FRAME:
+        display_execute_end_frame();
+        break;
+      case DISPLAY_COMMAND_DRAW:
+        display_execute_bind(command->texture);
+        display_execute_draw(list->sprites + command->first, command->count);
+        break;
+    }
+  }
+}
@@ -0,0 +1,730 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "job.h"
+#include "bits.h"
+#include "sync.h"
+#include "fiber.h"
+#include "memory.h"
+#include "log.h"
+
+#ifdef _MSC_VER
+#define JOB_THREAD_LOCAL __declspec(thread)
+#else
+#define JOB_THREAD_LOCAL _Thread_local
+#endif
+
+// idle rounds before a worker goes to sleep
+#ifndef JOB_SPINS
+#define JOB_SPINS 64
+#endif
+
+// fibers in the pool, and the stack size of each, for the fiber backend
+#ifndef JOB_FIBERS
+#define JOB_FIBERS 0x80
+#endif
+
+#ifndef JOB_FIBER_STACK
+#define JOB_FIBER_STACK (64 * KIBI)
+#endif
+
+#define JOB_DEQUE_CAPACITY 0x100
+
+// upper bound on the helper jobs a parallel loop submits
+#define JOB_PARALLEL_HELPERS 63
+
+// Reduce accumulators up to this size live on the caller's stack, one cache
+// line per helper. Larger ones go on the heap.
+#ifndef PARALLEL_INLINE_ACCUMULATOR
+#define PARALLEL_INLINE_ACCUMULATOR CACHE_LINE
+#endif
+
+typedef struct JobEntry {
+  JobFunction* function;
+  Void* data;
+  JobCounter* counter;
+} JobEntry;
+
+// A ring entry, which stays queued until some thread takes its job.
+typedef struct JobSlot {
+  JobEntry job;
+  _Atomic Bool queued;
+} JobSlot;
+
+typedef JobSlot* JobSlotPointer;
+
+#define WS_DEQUE_ELEMENT JobSlotPointer
+#define WS_DEQUE_INTERFACE
+#define WS_DEQUE_IMPLEMENTATION
+#include "generic/ws_deque.h"
+
+// A pooled fiber, which runs one job at a time.
+typedef struct JobFiber {
+  Fiber* fiber;
+  JobEntry job;
+  JobCounter* waiting;      // counter a parked fiber is waiting on
+  struct JobFiber* next;    // in the free pool or wait list
+} JobFiber;
+
+typedef struct JobWorker {
+  _Alignas(CACHE_LINE) WsDequeJobSlotPointer deque;
+  JobSlot ring[JOB_RING];
+  Index ring_cursor;
+  Thread* thread;
+  S32 index;
+  U32 random;
+  Char name[16];
+
+  // Fiber backend. The thread's own context schedules, and jobs run on
+  // pooled fibers. A fiber that finishes or parks can't put itself on a
+  // shared list while still running on its stack, so it leaves itself here
+  // and the scheduler files it after the switch.
+  Fiber* home;
+  JobFiber* current;
+  JobFiber* finished;
+  JobFiber* parked;
+} JobWorker;
+
+static JobWorker* job_workers = NULL;
+static S32 job_worker_count = 0;
+static Semaphore job_semaphore = {0};
+static _Atomic S32 job_sleeping = 0;
+static _Atomic Bool job_running = false;
+
+static JOB_THREAD_LOCAL JobWorker* job_self = NULL;
+
+static Bool job_fibers = false;
+static JobFiber* job_fiber_storage = NULL;
+static Mutex job_fiber_lock = {0};
+static JobFiber* job_fiber_free = NULL;
+static JobFiber* job_fiber_waiting = NULL;
+static _Atomic S32 job_fiber_waiting_count = 0;
+
+// A fiber may resume on another thread, so code that runs on both sides of a
+// switch reads the thread local through this, which the compiler can't
+// cache across the call.
+#ifdef _MSC_VER
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+static JobWorker* job_current()
+{
+  return job_self;
+}
+
+static U32 job_random(JobWorker* worker)
+{
+  // xorshift32
+  U32 x = worker->random;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  worker->random = x;
+  return x;
+}
+
+// Copies the job out, after which its owner may recycle the slot.
+static JobEntry job_claim(JobSlot* slot)
+{
+  const JobEntry job = slot->job;
+  atomic_store_explicit(&slot->queued, false, memory_order_release);
+  return job;
+}
+
+static Void job_execute(const JobEntry* job)
+{
+  job->function(job->data);
+  if (job->counter) {
+    atomic_fetch_sub_explicit(&job->counter->pending, 1, memory_order_release);
+  }
+}
+
+/*******************************************************************************
+ * FIBER BACKEND
+ ******************************************************************************/
+
+static Void job_fiber_entry(Void* data)
+{
+  JobFiber* const fiber = data;
+  for (;;) {
+    job_execute(&fiber->job);
+    JobWorker* const self = job_current();
+    self->finished = fiber;
+    platform_fiber_switch(fiber->fiber, self->home);
+  }
+}
+
+static JobFiber* job_fiber_acquire()
+{
+  mutex_lock(&job_fiber_lock);
+  JobFiber* const fiber = job_fiber_free;
+  if (fiber) {
+    job_fiber_free = fiber->next;
+  }
+  mutex_unlock(&job_fiber_lock);
+  return fiber;
+}
+
+// Takes a parked fiber whose counter has reached zero, if there is one.
+static JobFiber* job_fiber_take_ready()
+{
+  if (atomic_load_explicit(&job_fiber_waiting_count, memory_order_acquire) == 0) {
+    return NULL;
+  }
+  mutex_lock(&job_fiber_lock);
+  JobFiber** link = &job_fiber_waiting;
+  JobFiber* fiber = job_fiber_waiting;
+  while (fiber && atomic_load_explicit(&fiber->waiting->pending, memory_order_acquire) > 0) {
+    link = &fiber->next;
+    fiber = fiber->next;
+  }
+  if (fiber) {
+    *link = fiber->next;
+    atomic_fetch_sub_explicit(&job_fiber_waiting_count, 1, memory_order_relaxed);
+  }
+  mutex_unlock(&job_fiber_lock);
+  return fiber;
+}
+
+// Switches from the scheduler to a fiber, and files it away once it
+// switches back.
+static Void job_fiber_resume(JobWorker* self, JobFiber* fiber)
+{
+  self->current = fiber;
+  platform_fiber_switch(self->home, fiber->fiber);
+  self->current = NULL;
+
+  if (self->finished) {
+    JobFiber* const finished = self->finished;
+    self->finished = NULL;
+    mutex_lock(&job_fiber_lock);
+    finished->next = job_fiber_free;
+    job_fiber_free = finished;
+    mutex_unlock(&job_fiber_lock);
+  }
+
+  if (self->parked) {
+    JobFiber* const parked = self->parked;
+    self->parked = NULL;
+    mutex_lock(&job_fiber_lock);
+    parked->next = job_fiber_waiting;
+    job_fiber_waiting = parked;
+    atomic_fetch_add_explicit(&job_fiber_waiting_count, 1, memory_order_release);
+    mutex_unlock(&job_fiber_lock);
+  }
+}
+
+// Runs the job on a pooled fiber, or directly if the pool is empty, in which
+// case waits inside the job block this thread rather than parking.
+static Void job_fiber_run(JobWorker* self, const JobEntry* job)
+{
+  JobFiber* const fiber = job_fiber_acquire();
+  if (fiber == NULL) {
+    job_execute(job);
+    return;
+  }
+  fiber->job = *job;
+  job_fiber_resume(self, fiber);
+}
+
+// Suspends the running fiber until the counter reaches zero.
+static Void job_fiber_park(JobWorker* self, JobCounter* counter)
+{
+  JobFiber* const fiber = self->current;
+  fiber->waiting = counter;
+  self->parked = fiber;
+  platform_fiber_switch(fiber->fiber, self->home);
+}
+
+static Void job_fibers_init()
+{
+  job_fiber_storage = platform_virtual_alloc(JOB_FIBERS * sizeof(JobFiber));
+  if (job_fiber_storage == NULL) {
+    platform_log_error("failed to allocate job fibers");
+    exit(EXIT_CODE_FAILURE);
+  }
+  for (S32 i = 0; i < JOB_FIBERS; i++) {
+    JobFiber* const fiber = &job_fiber_storage[i];
+    fiber->fiber = platform_fiber_create(JOB_FIBER_STACK, job_fiber_entry, fiber);
+    if (fiber->fiber == NULL) {
+      platform_log_error("failed to create job fiber");
+      exit(EXIT_CODE_FAILURE);
+    }
+    fiber->next = job_fiber_free;
+    job_fiber_free = fiber;
+  }
+}
+
+static Void job_fibers_terminate()
+{
+  for (S32 i = 0; i < JOB_FIBERS; i++) {
+    platform_fiber_destroy(job_fiber_storage[i].fiber);
+  }
+  platform_virtual_free(job_fiber_storage);
+  job_fiber_storage = NULL;
+  job_fiber_free = NULL;
+  job_fiber_waiting = NULL;
+}
+
+// Enters the calling thread's scheduler context.
+static Void job_fiber_enter(JobWorker* self)
+{
+  self->home = platform_fiber_enter();
+  if (self->home == NULL) {
+    platform_log_error("failed to start job fiber scheduler");
+    exit(EXIT_CODE_FAILURE);
+  }
+}
+
+/*******************************************************************************
+ * SCHEDULING
+ ******************************************************************************/
+
+// Runs one pending job, from our own deque if possible. With fibers, resuming
+// a parked fiber that is ready comes first.
+static Bool job_try_run_one(JobWorker* self)
+{
+  if (job_fibers) {
+    JobFiber* const ready = job_fiber_take_ready();
+    if (ready) {
+      job_fiber_resume(self, ready);
+      return true;
+    }
+  }
+
+  JobSlot* slot = ws_deque_pop_JobSlotPointer(&self->deque, NULL);
+  if (slot == NULL && job_worker_count > 1) {
+    const S32 start = (S32) (job_random(self) % (U32) job_worker_count);
+    for (S32 i = 0; i < job_worker_count && slot == NULL; i++) {
+      JobWorker* const victim = &job_workers[(start + i) % job_worker_count];
+      if (victim != self) {
+        slot = ws_deque_steal_JobSlotPointer(&victim->deque, NULL);
+      }
+    }
+  }
+  if (slot == NULL) {
+    return false;
+  }
+  const JobEntry job = job_claim(slot);
+  if (job_fibers) {
+    job_fiber_run(self, &job);
+  } else {
+    job_execute(&job);
+  }
+  return true;
+}
+
+static Void job_worker_entry(Void* data)
+{
+  JobWorker* const self = data;
+  job_self = self;
+  if (job_fibers) {
+    job_fiber_enter(self);
+  }
+
+  S32 idle = 0;
+  while (atomic_load_explicit(&job_running, memory_order_acquire)) {
+    if (job_try_run_one(self)) {
+      idle = 0;
+      continue;
+    }
+    idle += 1;
+    if (idle < JOB_SPINS) {
+      platform_thread_yield();
+      continue;
+    }
+
+    // Register as sleeping before the last look, so that a submitter either
+    // sees us and posts, or we see its jobs.
+    atomic_fetch_add_explicit(&job_sleeping, 1, memory_order_seq_cst);
+    const Bool found = job_try_run_one(self);
+    if (found == false && atomic_load_explicit(&job_running, memory_order_acquire)) {
+      semaphore_wait(&job_semaphore);
+    }
+    atomic_fetch_sub_explicit(&job_sleeping, 1, memory_order_relaxed);
+    idle = 0;
+  }
+
+  if (job_fibers) {
+    platform_fiber_leave(self->home);
+  }
+}
+
+static Bool job_worker_init(JobWorker* worker, S32 index)
+{
+  for (S32 i = 0; i < JOB_RING; i++) {
+    atomic_init(&worker->ring[i].queued, false);
+  }
+  worker->ring_cursor = 0;
+  worker->thread = NULL;
+  worker->home = NULL;
+  worker->current = NULL;
+  worker->finished = NULL;
+  worker->parked = NULL;
+  worker->index = index;
+  worker->random = 0x9E3779B9u * (U32) (index + 1);
+  return ws_deque_init_JobSlotPointer(&worker->deque, JOB_DEQUE_CAPACITY);
+}
+
+// The core for worker i: the ith core of the mask, cycling. Without a mask
+// workers aren't pinned, since nothing else is, and pinned workers would
+// compete with the main and audio threads for cores the scheduler can't
+// move them off.
+static CoreMask job_worker_affinity(S32 index, CoreMask affinity)
+{
+  if (affinity == 0) {
+    return 0;
+  }
+  S32 skip = index % bits_popcount64(affinity);
+  CoreMask remaining = affinity;
+  while (skip > 0) {
+    remaining &= remaining - 1;
+    skip -= 1;
+  }
+  return remaining & (~remaining + 1);
+}
+
+Void job_init(S32 workers, CoreMask affinity, Bool fibers)
+{
+  ASSERT(job_workers == NULL);
+  const S32 cores = platform_core_count();
+  const S32 spare = affinity ? bits_popcount64(affinity) : cores - 1;
+  const S32 threads = workers < 0 ? 0 : workers == 0 ? spare : workers;
+  const S32 count = threads + 1;
+
+  job_workers = platform_virtual_alloc(count * sizeof(JobWorker));
+  semaphore_init(&job_semaphore, 0);
+  if (job_workers == NULL) {
+    platform_log_error("failed to initialize job system");
+    exit(EXIT_CODE_FAILURE);
+  }
+  for (S32 i = 0; i < count; i++) {
+    if (job_worker_init(&job_workers[i], i) == false) {
+      platform_log_error("failed to initialize job system");
+      exit(EXIT_CODE_FAILURE);
+    }
+  }
+
+  job_worker_count = count;
+  job_self = &job_workers[0];
+  job_fibers = fibers;
+  if (fibers) {
+    job_fibers_init();
+    job_fiber_enter(job_self);
+  }
+  atomic_store(&job_running, true);
+
+  for (S32 i = 1; i < count; i++) {
+    // Given a mask, each worker keeps to one core, so its deque and data
+    // stay warm in one cache.
+    JobWorker* const worker = &job_workers[i];
+    snprintf(worker->name, sizeof(worker->name), "job %d", i);
+    const ThreadConfig config = {
+      .name = worker->name,
+      .affinity = job_worker_affinity(i, affinity),
+      .priority = THREAD_CLASS_NORMAL,
+    };
+    worker->thread = platform_thread_create(job_worker_entry, worker, &config);
+    if (worker->thread == NULL) {
+      platform_log_error("failed to start job worker %d", i);
+      exit(EXIT_CODE_FAILURE);
+    }
+  }
+}
+
+Void job_terminate()
+{
+  if (job_workers == NULL) {
+    return;
+  }
+
+  // Finish anything still queued on the main thread, then wake everyone so
+  // they notice the flag.
+  while (job_try_run_one(job_self)) {
+  }
+  atomic_store(&job_running, false);
+  semaphore_post(&job_semaphore, job_worker_count);
+  for (S32 i = 1; i < job_worker_count; i++) {
+    platform_thread_join(job_workers[i].thread);
+  }
+
+  if (job_fibers) {
+    ASSERT(job_fiber_waiting == NULL);
+    platform_fiber_leave(job_self->home);
+    job_fibers_terminate();
+    job_fibers = false;
+  }
+
+  for (S32 i = 0; i < job_worker_count; i++) {
+    ws_deque_destroy_JobSlotPointer(&job_workers[i].deque);
+  }
+  platform_virtual_free(job_workers);
+  job_workers = NULL;
+  job_worker_count = 0;
+  job_self = NULL;
+}
+
+Void job_detach()
+{
+  if (job_workers == NULL) {
+    return;
+  }
+  JobWorker* const self = job_self;
+  ASSERT(self == &job_workers[0] && self->current == NULL);
+
+  // The deque belongs to the slot, but its owner's end is only safe from one
+  // thread at a time, so leave it empty.
+  while (job_try_run_one(self)) {
+  }
+  if (job_fibers) {
+    platform_fiber_leave(self->home);
+    self->home = NULL;
+  }
+  job_self = NULL;
+}
+
+Void job_attach()
+{
+  if (job_workers == NULL) {
+    return;
+  }
+  ASSERT(job_self == NULL);
+  job_self = &job_workers[0];
+  if (job_fibers) {
+    job_fiber_enter(job_self);
+  }
+}
+
+Void job_run(const Job* jobs, Index count, JobCounter* counter)
+{
+  if (counter) {
+    atomic_fetch_add_explicit(&counter->pending, count, memory_order_relaxed);
+  }
+
+  JobWorker* const self = job_self;
+  if (job_workers == NULL) {
+    for (Index i = 0; i < count; i++) {
+      JobEntry entry = { jobs[i].function, jobs[i].data, counter };
+      job_execute(&entry);
+    }
+    return;
+  }
+  ASSERT(self != NULL);
+
+  for (Index i = 0; i < count; i++) {
+    const JobEntry job = { jobs[i].function, jobs[i].data, counter };
+
+    // Jobs are taken out of order, so the next slot may still be queued
+    // even below JOB_RING outstanding. Rather than overwrite it, run the job
+    // now, and try the same slot for the next one.
+    JobSlot* const slot = &self->ring[self->ring_cursor];
+    if (atomic_load_explicit(&slot->queued, memory_order_acquire)) {
+      job_execute(&job);
+      continue;
+    }
+    self->ring_cursor = (self->ring_cursor + 1) % JOB_RING;
+    slot->job = job;
+    atomic_store_explicit(&slot->queued, true, memory_order_relaxed);
+    if (ws_deque_push_JobSlotPointer(&self->deque, slot) == false) {
+      // out of memory for the deque, so do it now
+      const JobEntry claimed = job_claim(slot);
+      job_execute(&claimed);
+    }
+  }
+
+  // Pairs with the registration in job_worker_entry.
+  atomic_thread_fence(memory_order_seq_cst);
+  const S32 sleeping = atomic_load_explicit(&job_sleeping, memory_order_relaxed);
+  if (sleeping > 0) {
+    semaphore_post(&job_semaphore, (S32) MIN((Index) sleeping, count));
+  }
+}
+
+Void job_wait(JobCounter* counter)
+{
+  while (atomic_load_explicit(&counter->pending, memory_order_acquire) > 0) {
+    // Inside a job on a fiber, set the fiber aside and let this thread run
+    // something else. Elsewhere, help until the counter drops.
+    JobWorker* const self = job_current();
+    if (self && self->current) {
+      job_fiber_park(self, counter);
+    } else if (self == NULL || job_try_run_one(self) == false) {
+      platform_thread_yield();
+    }
+  }
+}
+
+S32 job_thread_count()
+{
+  return MAX(job_worker_count, 1);
+}
+
+S32 job_thread_index()
+{
+  return job_self ? job_self->index : -1;
+}
+
+/*******************************************************************************
+ * PARALLEL LOOPS
+ ******************************************************************************/
+
+typedef struct ParallelLoop {
+  _Alignas(CACHE_LINE) _Atomic Index cursor;
+  Index end;
+  Index grain;
+  S32 participants;
+  ParallelForFunction* function;
+  ParallelReduceFunction* reduce;
+  Void* user;
+} ParallelLoop;
+
+typedef struct ParallelParticipant {
+  _Alignas(CACHE_LINE) ParallelLoop* loop;
+  Void* accumulator;
+} ParallelParticipant;
+
+typedef struct ParallelAccumulator {
+  _Alignas(CACHE_LINE) Byte data[PARALLEL_INLINE_ACCUMULATOR];
+} ParallelAccumulator;
+
+// Claims the next chunk, guided style: a share of what remains, so early
+// chunks are large and late chunks balance the tail.
+static Bool parallel_claim(ParallelLoop* loop, Index* begin, Index* end)
+{
+  Index cursor = atomic_load_explicit(&loop->cursor, memory_order_relaxed);
+  for (;;) {
+    const Index remaining = loop->end - cursor;
+    if (remaining <= 0) {
+      return false;
+    }
+    const Index share = remaining / (2 * loop->participants);
+    const Index size = MIN(remaining, MAX(share, loop->grain));
+    if (atomic_compare_exchange_weak_explicit(
+            &loop->cursor, &cursor, cursor + size, memory_order_relaxed, memory_order_relaxed)) {
+      *begin = cursor;
+      *end = cursor + size;
+      return true;
+    }
+  }
+}
+
+static Void parallel_participate(Void* data)
+{
+  ParallelParticipant* const participant = data;
+  ParallelLoop* const loop = participant->loop;
+  Index begin = 0;
+  Index end = 0;
+  while (parallel_claim(loop, &begin, &end)) {
+    if (loop->reduce) {
+      loop->reduce(begin, end, participant->accumulator, loop->user);
+    } else {
+      loop->function(begin, end, loop->user);
+    }
+  }
+}
+
+static Index parallel_grain(Index grain)
+{
+  return grain > 0 ? grain : PARALLEL_SERIAL_THRESHOLD;
+}
+
+Void platform_parallel_for(Index begin, Index end, Index grain, ParallelForFunction* function, Void* user)
+{
+  grain = parallel_grain(grain);
+  const S32 threads = job_thread_count();
+  if (end - begin <= grain || threads == 1 || job_self == NULL) {
+    if (end > begin) {
+      function(begin, end, user);
+    }
+    return;
+  }
+
+  ParallelLoop loop = {0};
+  atomic_init(&loop.cursor, begin);
+  loop.end = end;
+  loop.grain = grain;
+  loop.participants = (S32) MIN((Index) threads, (end - begin + grain - 1) / grain);
+  loop.function = function;
+  loop.user = user;
+
+  // Every helper shares one participant, since they need no state of their
+  // own. Helpers that start late find the range exhausted and return.
+  ParallelParticipant participant = { &loop, NULL };
+  Job jobs[JOB_PARALLEL_HELPERS];
+  const Index helpers = MIN((Index) loop.participants - 1, JOB_PARALLEL_HELPERS);
+  for (Index i = 0; i < helpers; i++) {
+    jobs[i] = (Job) { parallel_participate, &participant };
+  }
+
+  JobCounter counter = {0};
+  job_run(jobs, helpers, &counter);
+  parallel_participate(&participant);
+  job_wait(&counter);
+}
+
+Void platform_parallel_reduce(
+    Index begin,
+    Index end,
+    Index grain,
+    Void* result,
+    Index result_size,
+    ParallelReduceFunction* reduce,
+    ParallelCombineFunction* combine,
+    Void* user)
+{
+  grain = parallel_grain(grain);
+  const S32 threads = job_thread_count();
+  if (end - begin <= grain || threads == 1 || job_self == NULL) {
+    if (end > begin) {
+      reduce(begin, end, result, user);
+    }
+    return;
+  }
+
+  ParallelLoop loop = {0};
+  atomic_init(&loop.cursor, begin);
+  loop.end = end;
+  loop.grain = grain;
+  loop.participants = (S32) MIN((Index) MIN(threads, JOB_PARALLEL_HELPERS + 1), (end - begin + grain - 1) / grain);
+  loop.reduce = reduce;
+  loop.user = user;
+
+  // Each participant folds into its own accumulator, on its own cache lines.
+  ParallelAccumulator inline_accumulators[JOB_PARALLEL_HELPERS];
+  Byte* heap_accumulators = NULL;
+  Byte* aligned = (Byte*) inline_accumulators;
+  Index stride = sizeof(ParallelAccumulator);
+  if (result_size > PARALLEL_INLINE_ACCUMULATOR) {
+    stride = (result_size + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    heap_accumulators = malloc(stride * (loop.participants - 1) + CACHE_LINE);
+    if (heap_accumulators == NULL) {
+      platform_log_warn("failed to allocate reduce accumulators, running serially");
+      reduce(begin, end, result, user);
+      return;
+    }
+    aligned = (Byte*) (((uintptr_t) heap_accumulators + CACHE_LINE - 1) & ~(uintptr_t) (CACHE_LINE - 1));
+  }
+
+  ParallelParticipant participants[JOB_PARALLEL_HELPERS + 1];
+  Job jobs[JOB_PARALLEL_HELPERS];
+  // the calling thread folds straight into the result
+  participants[0].loop = &loop;
+  participants[0].accumulator = result;
+  for (S32 i = 1; i < loop.participants; i++) {
+    participants[i].loop = &loop;
+    participants[i].accumulator = aligned + (i - 1) * stride;
+    memcpy(participants[i].accumulator, result, result_size);
+    jobs[i - 1] = (Job) { parallel_participate, &participants[i] };
+  }
+
+  JobCounter counter = {0};
+  job_run(jobs, loop.participants - 1, &counter);
+  parallel_participate(&participants[0]);
+  job_wait(&counter);
+
+  for (S32 i = 1; i < loop.participants; i++) {
+    combine(result, participants[i].accumulator, user);
+  }
+  free(heap_accumulators);
+}
@@ -0,0 +1,91 @@
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdlib.h>
+#include <ucontext.h>
+#include "fiber.h"
+#include "memory.h"
+#include "log.h"
+
+struct Fiber {
+  ucontext_t context;
+  Byte* stack;
+  Index stack_size;
+  FiberEntry* entry;
+  Void* data;
+};
+
+// makecontext only passes int arguments, so the pointer is passed in halves.
+static Void fiber_trampoline(U32 low, U32 high)
+{
+  Fiber* const fiber = (Fiber*) (((uintptr_t) high << 32) | (uintptr_t) low);
+  fiber->entry(fiber->data);
+
+  // returning would exit the thread
+  platform_log_error("fiber entry point returned");
+  abort();
+}
+
+// Kept out of line, since the compiler assumes getcontext may return twice,
+// and would otherwise treat everything in platform_fiber_create as live
+// across it.
+static __attribute__((noinline)) Void fiber_prepare(Fiber* fiber, Byte* stack, Index size)
+{
+  ucontext_t* const context = &fiber->context;
+  const uintptr_t pointer = (uintptr_t) fiber;
+  getcontext(context);
+  context->uc_stack.ss_sp = stack;
+  context->uc_stack.ss_size = (Size) size;
+  context->uc_link = NULL;
+  makecontext(context, (Void (*)()) fiber_trampoline, 2, (U32) pointer, (U32) (pointer >> 32));
+}
+
+Fiber* platform_fiber_enter()
+{
+  Fiber* const fiber = calloc(1, sizeof(Fiber));
+  if (fiber == NULL) {
+    return NULL;
+  }
+  // the context is filled in by the first switch away from the thread
+  return fiber;
+}
+
+Void platform_fiber_leave(Fiber* thread_fiber)
+{
+  free(thread_fiber);
+}
+
+Fiber* platform_fiber_create(Index stack_size, FiberEntry* entry, Void* data)
+{
+  Fiber* const fiber = calloc(1, sizeof(Fiber));
+  if (fiber == NULL) {
+    return NULL;
+  }
+
+  // The lowest page of the stack is a guard, so overflow faults rather than
+  // corrupting the neighbouring allocation.
+  const Index page = (Index) platform_page_size();
+  const Index size = (stack_size + page - 1) / page * page + page;
+  fiber->stack = platform_virtual_alloc((Size) size);
+  if (fiber->stack == NULL) {
+    free(fiber);
+    return NULL;
+  }
+  platform_virtual_protect(fiber->stack, (Size) page, MEMORY_PROTECTION_NONE);
+  fiber->stack_size = size;
+  fiber->entry = entry;
+  fiber->data = data;
+
+  fiber_prepare(fiber, fiber->stack + page, size - page);
+  return fiber;
+}
+
+Void platform_fiber_destroy(Fiber* fiber)
+{
+  platform_virtual_free(fiber->stack);
+  free(fiber);
+}
+
+Void platform_fiber_switch(Fiber* from, Fiber* to)
+{
+  swapcontext(&from->context, &to->context);
+}
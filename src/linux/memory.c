@@ -0,0 +1,215 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "memory.h"
+#include "log.h"
+
+// munmap needs the length of the mapping, but platform_virtual_free only gets
+// a pointer. So each allocation is preceded by a page holding this header.
+typedef struct MemoryHeader {
+  Byte* base;
+  Size length;
+} MemoryHeader;
+
+static const S32 memory_protection_table[MEMORY_PROTECTION_CARDINAL] = {
+  [ MEMORY_PROTECTION_NONE        ] = PROT_NONE,
+  [ MEMORY_PROTECTION_READ        ] = PROT_READ,
+  [ MEMORY_PROTECTION_READ_WRITE  ] = PROT_READ | PROT_WRITE,
+};
+
+Size platform_page_size()
+{
+  static Size page_size = 0;
+  if (page_size == 0) {
+    page_size = (Size) sysconf(_SC_PAGESIZE);
+  }
+  return page_size;
+}
+
+static Size memory_round_up(Size size, Size granularity)
+{
+  return (size + granularity - 1) / granularity * granularity;
+}
+
+Void* platform_virtual_alloc(Size size)
+{
+  return platform_virtual_alloc_flags(size, MEMORY_FLAG_NONE);
+}
+
+Void* platform_virtual_alloc_flags(Size size, MemoryFlags flags)
+{
+  const Size page = platform_page_size();
+  const Bool huge = flags & (MEMORY_FLAG_HUGE_PAGES_TRANSPARENT | MEMORY_FLAG_HUGE_PAGES_EXPLICIT);
+  const Size alignment = huge ? MEMORY_HUGE_PAGE_SIZE : page;
+  const Size rounded = memory_round_up(size, alignment);
+
+  // Reserve enough address space for the header page, the allocation, and
+  // any slack needed to align the allocation.
+  const Size length = rounded + alignment;
+  Byte* const base = mmap(NULL, length, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED) {
+    platform_log_error("out of memory");
+    exit(EXIT_CODE_FAILURE);
+  }
+
+  const uintptr_t address = (uintptr_t) (base + page);
+  Byte* const pointer = (Byte*) ((address + alignment - 1) & ~(alignment - 1));
+  Byte* const header_page = pointer - page;
+
+  Bool mapped = false;
+  if (flags & MEMORY_FLAG_HUGE_PAGES_EXPLICIT) {
+    const S32 map_flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB;
+    const S32 prot = PROT_READ | PROT_WRITE;
+    mapped = mmap(pointer, rounded, prot, map_flags, -1, 0) != MAP_FAILED;
+    if (mapped == false) {
+      platform_log_warn("explicit huge pages unavailable; falling back to regular pages");
+    }
+  }
+
+  // A failed MAP_FIXED mapping may leave a hole in the reservation, so the
+  // fallback maps over the range rather than changing its protection.
+  if (mapped == false) {
+    const S32 map_flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED;
+    const S32 prot = PROT_READ | PROT_WRITE;
+    if (mmap(header_page, page + rounded, prot, map_flags, -1, 0) == MAP_FAILED) {
+      platform_log_error("out of memory");
+      exit(EXIT_CODE_FAILURE);
+    }
+    if (huge) {
+      madvise(pointer, rounded, MADV_HUGEPAGE);
+    }
+  } else {
+    mprotect(header_page, page, PROT_READ | PROT_WRITE);
+  }
+
+  MemoryHeader* const header = (MemoryHeader*) pointer - 1;
+  header->base = base;
+  header->length = length;
+  return pointer;
+}
+
+Void platform_virtual_free(Void* pointer)
+{
+  if (pointer) {
+    const MemoryHeader* const header = (MemoryHeader*) pointer - 1;
+    munmap(header->base, header->length);
+  }
+}
+
+// Writing each page back to itself forces it to be faulted in as writable,
+// without disturbing its contents.
+static Void memory_touch(Byte* pointer, Size size)
+{
+  const Size page = platform_page_size();
+  for (Size offset = 0; offset < size; offset += page) {
+    volatile Byte* const p = pointer + offset;
+    *p = *p;
+  }
+}
+
+// Subject to RLIMIT_MEMLOCK for unprivileged processes.
+Bool platform_memory_lock(Void* pointer, Size size)
+{
+  memory_touch(pointer, size);
+  return mlock(pointer, size) == 0;
+}
+
+Void platform_memory_unlock(Void* pointer, Size size)
+{
+  munlock(pointer, size);
+}
+
+Void* platform_locked_alloc(Size size)
+{
+  const S32 flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE;
+  Void* const pointer = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if (pointer == MAP_FAILED) {
+    platform_log_error("out of memory");
+    exit(EXIT_CODE_FAILURE);
+  }
+  const Bool locked = platform_memory_lock(pointer, size);
+  if (locked == false) {
+    platform_log_warn("failed to lock memory");
+  }
+  return pointer;
+}
+
+Void platform_locked_free(Void* pointer, Size size)
+{
+  munlock(pointer, size);
+  munmap(pointer, size);
+}
+
+Void* platform_virtual_reserve(Size size)
+{
+  Void* const pointer = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return pointer == MAP_FAILED ? NULL : pointer;
+}
+
+Void platform_virtual_release(Void* pointer, Size size)
+{
+  munmap(pointer, size);
+}
+
+Bool platform_virtual_commit(Void* pointer, Size size)
+{
+  return mprotect(pointer, size, PROT_READ | PROT_WRITE) == 0;
+}
+
+// Mapping fresh pages over the range drops the old ones along with their
+// commit charge, which madvise alone would not.
+Void platform_virtual_decommit(Void* pointer, Size size)
+{
+  const S32 flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE;
+  mmap(pointer, size, PROT_NONE, flags, -1, 0);
+}
+
+Bool platform_virtual_protect(Void* pointer, Size size, MemoryProtection protection)
+{
+  return mprotect(pointer, size, memory_protection_table[protection]) == 0;
+}
+
+Size platform_ring_granularity()
+{
+  return platform_page_size();
+}
+
+Void* platform_ring_alloc(Size size)
+{
+  const S32 fd = memfd_create("ring", MFD_CLOEXEC);
+  if (fd < 0) {
+    return NULL;
+  }
+  if (ftruncate(fd, (off_t) size) != 0) {
+    close(fd);
+    return NULL;
+  }
+
+  // claim the whole range, then map both views of the file over it
+  Byte* const base = platform_virtual_reserve(2 * size);
+  if (base == NULL) {
+    close(fd);
+    return NULL;
+  }
+
+  const S32 flags = MAP_SHARED | MAP_FIXED;
+  const S32 prot = PROT_READ | PROT_WRITE;
+  const Void* const lower = mmap(base, size, prot, flags, fd, 0);
+  const Void* const upper = mmap(base + size, size, prot, flags, fd, 0);
+
+  // the mappings hold references to the file
+  close(fd);
+
+  if (lower == MAP_FAILED || upper == MAP_FAILED) {
+    munmap(base, 2 * size);
+    return NULL;
+  }
+
+  return base;
+}
+
+Void platform_ring_free(Void* pointer, Size size)
+{
+  munmap(pointer, 2 * size);
+}
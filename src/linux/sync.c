@@ -0,0 +1,22 @@
+#define _GNU_SOURCE
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "sync.h"
+
+// Process-private futexes skip the lookup of the backing page.
+
+Void platform_address_wait(_Atomic U32* address, U32 expected)
+{
+  syscall(SYS_futex, (U32*) address, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+Void platform_address_wake_one(_Atomic U32* address)
+{
+  syscall(SYS_futex, (U32*) address, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+Void platform_address_wake_all(_Atomic U32* address)
+{
+  syscall(SYS_futex, (U32*) address, FUTEX_WAKE_PRIVATE, INT32_MAX, NULL, NULL, 0);
+}
@@ -0,0 +1,154 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "thread.h"
+#include "log.h"
+
+// SCHED_FIFO priority for audio threads, above most kernel threads but below
+// the ones that service interrupts
+#ifndef THREAD_AUDIO_PRIORITY
+#define THREAD_AUDIO_PRIORITY 80
+#endif
+
+struct Thread {
+  pthread_t handle;
+  ThreadEntry* entry;
+  Void* data;
+  ThreadConfig config;
+};
+
+static Void thread_apply_config(const ThreadConfig* config)
+{
+  if (config->name && platform_thread_set_name(config->name) == false) {
+    platform_log_warn("failed to name thread %s", config->name);
+  }
+  if (config->affinity && platform_thread_set_affinity(config->affinity) == false) {
+    platform_log_warn("failed to set thread affinity");
+  }
+  if (config->priority != THREAD_CLASS_NORMAL && platform_thread_set_class(config->priority) == false) {
+    platform_log_warn("failed to set thread priority");
+  }
+}
+
+static Void* thread_trampoline(Void* parameter)
+{
+  Thread* const thread = parameter;
+  thread_apply_config(&thread->config);
+  thread->entry(thread->data);
+  return NULL;
+}
+
+Thread* platform_thread_create(ThreadEntry* entry, Void* data, const ThreadConfig* config)
+{
+  Thread* const thread = malloc(sizeof(Thread));
+  if (thread == NULL) {
+    return NULL;
+  }
+  thread->entry = entry;
+  thread->data = data;
+  thread->config = config ? *config : (ThreadConfig) {0};
+  const S32 status = pthread_create(&thread->handle, NULL, thread_trampoline, thread);
+  if (status != 0) {
+    platform_log_error("failed to create thread (%d)", status);
+    free(thread);
+    return NULL;
+  }
+  return thread;
+}
+
+Void platform_thread_join(Thread* thread)
+{
+  const S32 status = pthread_join(thread->handle, NULL);
+  if (status != 0) {
+    platform_log_warn("failed to join thread (%d)", status);
+  }
+  free(thread);
+}
+
+Void platform_thread_yield()
+{
+  sched_yield();
+}
+
+Bool platform_thread_set_name(const Char* name)
+{
+  // the kernel limits names to 15 characters
+  Char truncated[16] = {0};
+  strncpy(truncated, name, sizeof(truncated) - 1);
+  return pthread_setname_np(pthread_self(), truncated) == 0;
+}
+
+Bool platform_thread_set_affinity(CoreMask affinity)
+{
+  if (affinity == 0) {
+    return true;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (S32 core = 0; core < 64; core++) {
+    if (affinity & ((CoreMask) 1 << core)) {
+      CPU_SET(core, &set);
+    }
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+static Bool thread_set_nice(S32 nice)
+{
+  return setpriority(PRIO_PROCESS, (id_t) gettid(), nice) == 0;
+}
+
+Bool platform_thread_set_class(ThreadClass priority)
+{
+  ASSERT(priority >= 0 && priority < THREAD_CLASS_CARDINAL);
+
+  struct sched_param param = {0};
+  if (priority == THREAD_CLASS_AUDIO) {
+    param.sched_priority = MIN(THREAD_AUDIO_PRIORITY, sched_get_priority_max(SCHED_FIFO));
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0) {
+      return true;
+    }
+
+    // Without the privilege for real-time scheduling, take the best
+    // niceness RLIMIT_NICE allows.
+    platform_log_warn("SCHED_FIFO unavailable for audio thread, falling back to niceness");
+    struct rlimit limit = {0};
+    if (getrlimit(RLIMIT_NICE, &limit) == 0 && limit.rlim_cur > 1) {
+      return thread_set_nice(20 - (S32) MIN(limit.rlim_cur, 40));
+    }
+    return false;
+  }
+
+  param.sched_priority = 0;
+  if (pthread_setschedparam(pthread_self(), SCHED_OTHER, &param) != 0) {
+    return false;
+  }
+  switch (priority) {
+    case THREAD_CLASS_BACKGROUND:
+      return thread_set_nice(10);
+    case THREAD_CLASS_HIGH:
+      return thread_set_nice(-5);
+    default:
+      return thread_set_nice(0);
+  }
+}
+
+S32 platform_thread_current_core()
+{
+  const S32 core = sched_getcpu();
+  return core >= 0 ? core : 0;
+}
+
+S32 platform_core_count()
+{
+  cpu_set_t set;
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    return MAX(CPU_COUNT(&set), 1);
+  }
+  const long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (S32) count : 1;
+}
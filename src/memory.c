@@ -0,0 +1,134 @@
+#include <stdatomic.h>
+#include "memory.h"
+
+// Each tag gets its own cache line, since different subsystems allocate from
+// different threads.
+typedef struct MemoryCounters {
+  _Alignas(CACHE_LINE) _Atomic Index reserved;
+  _Atomic Index committed;
+  _Atomic Index peak;
+  _Atomic Index allocations;
+  _Atomic Index total;
+} MemoryCounters;
+
+static MemoryCounters memory_counters[MEMORY_TAGS] = {0};
+
+// The system works in whole pages, so the totals do too.
+static Index memory_pages(Size size)
+{
+  const Size page = platform_page_size();
+  return (Index) ((size + page - 1) / page * page);
+}
+
+static Void memory_count_reserve(MemoryTag tag, Size size)
+{
+  ASSERT(tag < MEMORY_TAGS);
+  if (tag == MEMORY_TAG_NONE) {
+    return;
+  }
+  MemoryCounters* const counters = &memory_counters[tag];
+  atomic_fetch_add_explicit(&counters->reserved, memory_pages(size), memory_order_relaxed);
+  atomic_fetch_add_explicit(&counters->allocations, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&counters->total, 1, memory_order_relaxed);
+}
+
+static Void memory_count_release(MemoryTag tag, Size size)
+{
+  ASSERT(tag < MEMORY_TAGS);
+  if (tag == MEMORY_TAG_NONE) {
+    return;
+  }
+  MemoryCounters* const counters = &memory_counters[tag];
+  atomic_fetch_sub_explicit(&counters->reserved, memory_pages(size), memory_order_relaxed);
+  atomic_fetch_sub_explicit(&counters->allocations, 1, memory_order_relaxed);
+}
+
+static Void memory_count_commit(MemoryTag tag, Size size)
+{
+  ASSERT(tag < MEMORY_TAGS);
+  if (tag == MEMORY_TAG_NONE) {
+    return;
+  }
+  MemoryCounters* const counters = &memory_counters[tag];
+  const Index pages = memory_pages(size);
+  const Index previous = atomic_fetch_add_explicit(&counters->committed, pages, memory_order_relaxed);
+  const Index committed = previous + pages;
+  Index peak = atomic_load_explicit(&counters->peak, memory_order_relaxed);
+  while (committed > peak) {
+    const Bool swapped = atomic_compare_exchange_weak_explicit(
+        &counters->peak, &peak, committed,
+        memory_order_relaxed, memory_order_relaxed);
+    if (swapped) {
+      break;
+    }
+  }
+}
+
+static Void memory_count_decommit(MemoryTag tag, Size size)
+{
+  ASSERT(tag < MEMORY_TAGS);
+  if (tag == MEMORY_TAG_NONE) {
+    return;
+  }
+  MemoryCounters* const counters = &memory_counters[tag];
+  atomic_fetch_sub_explicit(&counters->committed, memory_pages(size), memory_order_relaxed);
+}
+
+Void* platform_virtual_alloc_tagged(Size size, MemoryTag tag)
+{
+  Void* const pointer = platform_virtual_alloc(size);
+  memory_count_reserve(tag, size);
+  memory_count_commit(tag, size);
+  return pointer;
+}
+
+Void platform_virtual_free_tagged(Void* pointer, Size size, MemoryTag tag)
+{
+  platform_virtual_free(pointer);
+  memory_count_decommit(tag, size);
+  memory_count_release(tag, size);
+}
+
+Void* platform_virtual_reserve_tagged(Size size, MemoryTag tag)
+{
+  Void* const pointer = platform_virtual_reserve(size);
+  if (pointer) {
+    memory_count_reserve(tag, size);
+  }
+  return pointer;
+}
+
+Void platform_virtual_release_tagged(Void* pointer, Size size, Size committed, MemoryTag tag)
+{
+  platform_virtual_release(pointer, size);
+  memory_count_decommit(tag, committed);
+  memory_count_release(tag, size);
+}
+
+Bool platform_virtual_commit_tagged(Void* pointer, Size size, MemoryTag tag)
+{
+  const Bool status = platform_virtual_commit(pointer, size);
+  if (status) {
+    memory_count_commit(tag, size);
+  }
+  return status;
+}
+
+Void platform_virtual_decommit_tagged(Void* pointer, Size size, MemoryTag tag)
+{
+  platform_virtual_decommit(pointer, size);
+  memory_count_decommit(tag, size);
+}
+
+MemoryStats platform_memory_stats(MemoryTag tag)
+{
+  ASSERT(tag < MEMORY_TAGS);
+  MemoryCounters* const counters = &memory_counters[tag];
+  MemoryStats out;
+  out.reserved    = atomic_load_explicit(&counters->reserved, memory_order_relaxed);
+  out.committed   = atomic_load_explicit(&counters->committed, memory_order_relaxed);
+  out.peak        = atomic_load_explicit(&counters->peak, memory_order_relaxed);
+  out.allocations = atomic_load_explicit(&counters->allocations, memory_order_relaxed);
+  out.total       = atomic_load_explicit(&counters->total, memory_order_relaxed);
+  return out;
+}
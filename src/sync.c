@@ -0,0 +1,134 @@
+#include "sync.h"
+
+/*******************************************************************************
+ * MUTEX
+ ******************************************************************************/
+
+// After Drepper, "Futexes Are Tricky", mutex 3.
+
+Bool mutex_try_lock(Mutex* mutex)
+{
+  U32 expected = 0;
+  return atomic_compare_exchange_strong_explicit(
+      &mutex->state, &expected, 1, memory_order_acquire, memory_order_relaxed);
+}
+
+Void mutex_lock(Mutex* mutex)
+{
+  if (mutex_try_lock(mutex)) {
+    return;
+  }
+
+  for (S32 i = 0; i < SYNC_SPINS; i++) {
+    SYNC_PAUSE();
+    if (atomic_load_explicit(&mutex->state, memory_order_relaxed) == 0 && mutex_try_lock(mutex)) {
+      return;
+    }
+  }
+
+  // Mark the mutex as having sleepers, since we can't tell whether others
+  // are already asleep, and sleep until we take it in that state.
+  while (atomic_exchange_explicit(&mutex->state, 2, memory_order_acquire) != 0) {
+    platform_address_wait(&mutex->state, 2);
+  }
+}
+
+Void mutex_unlock(Mutex* mutex)
+{
+  if (atomic_exchange_explicit(&mutex->state, 0, memory_order_release) == 2) {
+    platform_address_wake_one(&mutex->state);
+  }
+}
+
+/*******************************************************************************
+ * EVENT
+ ******************************************************************************/
+
+Void event_signal(Event* event)
+{
+  const U32 previous = atomic_exchange_explicit(&event->signaled, 1, memory_order_seq_cst);
+  if (previous == 0 && atomic_load_explicit(&event->sleepers, memory_order_seq_cst) > 0) {
+    platform_address_wake_one(&event->signaled);
+  }
+}
+
+static Bool event_try_consume(Event* event)
+{
+  U32 expected = 1;
+  return atomic_compare_exchange_strong_explicit(
+      &event->signaled, &expected, 0, memory_order_acquire, memory_order_relaxed);
+}
+
+Void event_wait(Event* event)
+{
+  for (S32 i = 0; i < SYNC_SPINS; i++) {
+    if (event_try_consume(event)) {
+      return;
+    }
+    SYNC_PAUSE();
+  }
+
+  // Either the signaller sees us counted, or the kernel sees the signal when
+  // it compares the word.
+  atomic_fetch_add_explicit(&event->sleepers, 1, memory_order_seq_cst);
+  while (event_try_consume(event) == false) {
+    platform_address_wait(&event->signaled, 0);
+  }
+  atomic_fetch_sub_explicit(&event->sleepers, 1, memory_order_relaxed);
+}
+
+/*******************************************************************************
+ * SEMAPHORE
+ ******************************************************************************/
+
+Void semaphore_init(Semaphore* semaphore, S32 count)
+{
+  ASSERT(count >= 0);
+  atomic_init(&semaphore->count, (U32) count);
+  atomic_init(&semaphore->sleepers, 0);
+}
+
+Bool semaphore_try_wait(Semaphore* semaphore)
+{
+  U32 count = atomic_load_explicit(&semaphore->count, memory_order_relaxed);
+  while (count > 0) {
+    if (atomic_compare_exchange_weak_explicit(
+            &semaphore->count, &count, count - 1, memory_order_acquire, memory_order_relaxed)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Void semaphore_post(Semaphore* semaphore, S32 count)
+{
+  if (count <= 0) {
+    return;
+  }
+  atomic_fetch_add_explicit(&semaphore->count, (U32) count, memory_order_seq_cst);
+  const U32 sleepers = atomic_load_explicit(&semaphore->sleepers, memory_order_seq_cst);
+  if (sleepers == 0) {
+    return;
+  }
+  if (count == 1) {
+    platform_address_wake_one(&semaphore->count);
+  } else {
+    platform_address_wake_all(&semaphore->count);
+  }
+}
+
+Void semaphore_wait(Semaphore* semaphore)
+{
+  for (S32 i = 0; i < SYNC_SPINS; i++) {
+    if (semaphore_try_wait(semaphore)) {
+      return;
+    }
+    SYNC_PAUSE();
+  }
+
+  atomic_fetch_add_explicit(&semaphore->sleepers, 1, memory_order_seq_cst);
+  while (semaphore_try_wait(semaphore) == false) {
+    platform_address_wait(&semaphore->count, 0);
+  }
+  atomic_fetch_sub_explicit(&semaphore->sleepers, 1, memory_order_relaxed);
+}
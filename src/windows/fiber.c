@@ -0,0 +1,72 @@
+#include "windows/wrapper.h"
+#include <stdlib.h>
+#include "fiber.h"
+#include "log.h"
+
+struct Fiber {
+  LPVOID handle;
+  FiberEntry* entry;
+  Void* data;
+};
+
+static Void WINAPI fiber_trampoline(LPVOID parameter)
+{
+  Fiber* const fiber = parameter;
+  fiber->entry(fiber->data);
+
+  // returning would exit the thread
+  platform_log_error("fiber entry point returned");
+  abort();
+}
+
+Fiber* platform_fiber_enter()
+{
+  Fiber* const fiber = malloc(sizeof(Fiber));
+  if (fiber == NULL) {
+    return NULL;
+  }
+  fiber->entry = NULL;
+  fiber->data = NULL;
+  fiber->handle = ConvertThreadToFiberEx(NULL, FIBER_FLAG_FLOAT_SWITCH);
+  if (fiber->handle == NULL) {
+    platform_log_error("failed to convert thread to fiber (%lu)", GetLastError());
+    free(fiber);
+    return NULL;
+  }
+  return fiber;
+}
+
+Void platform_fiber_leave(Fiber* thread_fiber)
+{
+  ConvertFiberToThread();
+  free(thread_fiber);
+}
+
+Fiber* platform_fiber_create(Index stack_size, FiberEntry* entry, Void* data)
+{
+  Fiber* const fiber = malloc(sizeof(Fiber));
+  if (fiber == NULL) {
+    return NULL;
+  }
+  fiber->entry = entry;
+  fiber->data = data;
+  fiber->handle = CreateFiberEx((SIZE_T) stack_size, (SIZE_T) stack_size, FIBER_FLAG_FLOAT_SWITCH, fiber_trampoline, fiber);
+  if (fiber->handle == NULL) {
+    platform_log_error("failed to create fiber (%lu)", GetLastError());
+    free(fiber);
+    return NULL;
+  }
+  return fiber;
+}
+
+Void platform_fiber_destroy(Fiber* fiber)
+{
+  DeleteFiber(fiber->handle);
+  free(fiber);
+}
+
+Void platform_fiber_switch(Fiber* from, Fiber* to)
+{
+  UNUSED_PARAMETER(from);
+  SwitchToFiber(to->handle);
+}
@@ -2,8 +2,71 @@
 #include "memory.h"
 #include "log.h"
 
+static const DWORD memory_protection_table[MEMORY_PROTECTION_CARDINAL] = {
+  [ MEMORY_PROTECTION_NONE        ] = PAGE_NOACCESS,
+  [ MEMORY_PROTECTION_READ        ] = PAGE_READONLY,
+  [ MEMORY_PROTECTION_READ_WRITE  ] = PAGE_READWRITE,
+};
+
+// Large pages can only be allocated by a process holding SeLockMemoryPrivilege,
+// which is disabled by default even for users that have been granted it.
+static Bool memory_enable_large_pages()
+{
+  static Bool attempted = false;
+  static Bool enabled = false;
+  if (attempted) {
+    return enabled;
+  }
+  attempted = true;
+
+  HANDLE token = NULL;
+  const BOOL open_status = OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES, &token);
+  if (open_status == FALSE) {
+    return false;
+  }
+
+  TOKEN_PRIVILEGES privileges = {0};
+  privileges.PrivilegeCount = 1;
+  privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+  const BOOL lookup_status = LookupPrivilegeValue(NULL, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid);
+  if (lookup_status) {
+    // AdjustTokenPrivileges succeeds even if the privilege was not assigned
+    AdjustTokenPrivileges(token, FALSE, &privileges, 0, NULL, NULL);
+    enabled = GetLastError() == ERROR_SUCCESS;
+  }
+
+  CloseHandle(token);
+  return enabled;
+}
+
+Size platform_page_size()
+{
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwPageSize;
+}
+
 Void* platform_virtual_alloc(Size size)
 {
+  return platform_virtual_alloc_flags(size, MEMORY_FLAG_NONE);
+}
+
+// Windows has no transparent huge pages, so that flag is ignored here.
+Void* platform_virtual_alloc_flags(Size size, MemoryFlags flags)
+{
+  if (flags & MEMORY_FLAG_HUGE_PAGES_EXPLICIT) {
+    const Size large = GetLargePageMinimum();
+    if (large > 0 && memory_enable_large_pages()) {
+      const Size rounded = (size + large - 1) / large * large;
+      const DWORD type = MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES;
+      Void* const pointer = VirtualAlloc(NULL, rounded, type, PAGE_READWRITE);
+      if (pointer) {
+        return pointer;
+      }
+    }
+    platform_log_warn("large pages unavailable; falling back to regular pages");
+  }
+
   Void* const pointer = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
   if (pointer == NULL) {
     platform_log_error("out of memory");
@@ -16,3 +79,159 @@ Void platform_virtual_free(Void* pointer)
 {
   VirtualFree(pointer, 0, MEM_RELEASE);
 }
+
+// Writing each page back to itself forces it to be faulted in as writable,
+// without disturbing its contents.
+static Void memory_touch(Byte* pointer, Size size)
+{
+  const Size page = platform_page_size();
+  for (Size offset = 0; offset < size; offset += page) {
+    volatile Byte* const p = pointer + offset;
+    *p = *p;
+  }
+}
+
+Bool platform_memory_lock(Void* pointer, Size size)
+{
+  // The amount of memory a process can lock is bounded by its minimum working
+  // set size, so grow the working set to make room.
+  const HANDLE process = GetCurrentProcess();
+  SIZE_T minimum = 0;
+  SIZE_T maximum = 0;
+  if (GetProcessWorkingSetSize(process, &minimum, &maximum)) {
+    minimum += size;
+    maximum = MAX(maximum, minimum);
+    SetProcessWorkingSetSize(process, minimum, maximum);
+  }
+
+  memory_touch(pointer, size);
+  return VirtualLock(pointer, size) != FALSE;
+}
+
+Void platform_memory_unlock(Void* pointer, Size size)
+{
+  VirtualUnlock(pointer, size);
+}
+
+Void* platform_locked_alloc(Size size)
+{
+  Void* const pointer = platform_virtual_alloc(size);
+  const Bool locked = platform_memory_lock(pointer, size);
+  if (locked == false) {
+    platform_log_warn("failed to lock memory");
+  }
+  return pointer;
+}
+
+Void platform_locked_free(Void* pointer, Size size)
+{
+  platform_memory_unlock(pointer, size);
+  platform_virtual_free(pointer);
+}
+
+Void* platform_virtual_reserve(Size size)
+{
+  return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+Void platform_virtual_release(Void* pointer, Size size)
+{
+  UNUSED_PARAMETER(size);
+  VirtualFree(pointer, 0, MEM_RELEASE);
+}
+
+Bool platform_virtual_commit(Void* pointer, Size size)
+{
+  return VirtualAlloc(pointer, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+}
+
+Void platform_virtual_decommit(Void* pointer, Size size)
+{
+  VirtualFree(pointer, size, MEM_DECOMMIT);
+}
+
+Bool platform_virtual_protect(Void* pointer, Size size, MemoryProtection protection)
+{
+  DWORD old = 0;
+  return VirtualProtect(pointer, size, memory_protection_table[protection], &old) != FALSE;
+}
+
+Size platform_ring_granularity()
+{
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwAllocationGranularity;
+}
+
+// Placeholder reservations let us claim the whole range up front and then
+// map both views of the section into it, without racing other threads for
+// the address space.
+Void* platform_ring_alloc(Size size)
+{
+  Byte* const placeholder = VirtualAlloc2(
+      NULL,                                   // process
+      NULL,                                   // base address
+      2 * size,                               // size
+      MEM_RESERVE | MEM_RESERVE_PLACEHOLDER,  // allocation type
+      PAGE_NOACCESS,                          // protection
+      NULL,                                   // extended parameters
+      0                                       // parameter count
+      );
+  if (placeholder == NULL) {
+    return NULL;
+  }
+
+  // split the placeholder in two
+  const BOOL split_status = VirtualFree(placeholder, size, MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER);
+  if (split_status == FALSE) {
+    VirtualFree(placeholder, 0, MEM_RELEASE);
+    return NULL;
+  }
+
+  const HANDLE section = CreateFileMapping(
+      INVALID_HANDLE_VALUE,         // backed by the paging file
+      NULL,                         // default security
+      PAGE_READWRITE,               // protection
+      (DWORD) ((U64) size >> 32),   // maximum size (high)
+      (DWORD) size,                 // maximum size (low)
+      NULL                          // name
+      );
+  if (section == NULL) {
+    VirtualFree(placeholder, 0, MEM_RELEASE);
+    VirtualFree(placeholder + size, 0, MEM_RELEASE);
+    return NULL;
+  }
+
+  Void* const lower = MapViewOfFile3(
+      section, NULL, placeholder, 0, size,
+      MEM_REPLACE_PLACEHOLDER, PAGE_READWRITE, NULL, 0);
+  Void* const upper = MapViewOfFile3(
+      section, NULL, placeholder + size, 0, size,
+      MEM_REPLACE_PLACEHOLDER, PAGE_READWRITE, NULL, 0);
+
+  // the views hold references to the section
+  CloseHandle(section);
+
+  if (lower == NULL || upper == NULL) {
+    if (lower) {
+      UnmapViewOfFile(lower);
+    } else {
+      VirtualFree(placeholder, 0, MEM_RELEASE);
+    }
+    if (upper) {
+      UnmapViewOfFile(upper);
+    } else {
+      VirtualFree(placeholder + size, 0, MEM_RELEASE);
+    }
+    return NULL;
+  }
+
+  return placeholder;
+}
+
+Void platform_ring_free(Void* pointer, Size size)
+{
+  Byte* const base = pointer;
+  UnmapViewOfFile(base);
+  UnmapViewOfFile(base + size);
+}
@@ -7,7 +7,6 @@
 
 #ifdef PLATFORM_AUDIO
 #include <audioclient.h>
-#include <avrt.h>
 #include <mmdeviceapi.h>
 #endif
 
@@ -15,7 +14,16 @@
 #include <stdatomic.h>
 #include "loop.h"
 #include "audio_format.h"
+#include "memory.h"
 #include "log.h"
+#include "job.h"
+#include "sync.h"
+#include "display.h"
+
+#define ATOMIC_QUEUE_INTERFACE
+#define ATOMIC_QUEUE_IMPLEMENTATION
+#define ATOMIC_QUEUE_ELEMENT Event
+#include "generic/atomic_queue.h"
 
 #define GLAD_GL_IMPLEMENTATION
 #define GLAD_WGL_IMPLEMENTATION
@@ -28,10 +36,31 @@
 #define SHELL_GL_VERSION_MINOR 5
 #define SHELL_AUDIO_TIMEOUT 2000
 
-#define VK_CARDINAL 0x100
+#ifndef SHELL_VIDEO_SCRATCH
+#define SHELL_VIDEO_SCRATCH (64 * MEBI)
+#endif
+
+#ifndef SHELL_AUDIO_SCRATCH
+#define SHELL_AUDIO_SCRATCH (16 * MEBI)
+#endif
+
+// amount of the audio thread's stack and scratch memory to lock, on request
+#ifndef SHELL_AUDIO_STACK_LOCK
+#define SHELL_AUDIO_STACK_LOCK (64 * KIBI)
+#endif
+
+#ifndef SHELL_AUDIO_SCRATCH_LOCK
+#define SHELL_AUDIO_SCRATCH_LOCK (1 * MEBI)
+#endif
 
-#define THREAD_EXIT_SUCCESS 0
-#define THREAD_EXIT_FAILURE 1
+// events buffered between the window and the simulation thread
+#ifndef SHELL_EVENT_QUEUE
+#define SHELL_EVENT_QUEUE 0x400
+#endif
+
+#define SHELL_DISPLAY_LISTS 2
+
+#define VK_CARDINAL 0x100
 
 #ifdef PLATFORM_AUDIO
 
@@ -59,6 +88,25 @@ static HWND shell_window = NULL;
 // signal for audio thread
 static _Atomic Bool quit_signal = false;
 
+// per-frame scratch memory
+static Arena shell_video_scratch = {0};
+static Arena shell_audio_scratch = {0};
+
+// Pipelined rendering. The simulation thread records into a free list and
+// posts it as ready; the main thread submits ready lists and frees them.
+typedef struct ShellPipeline {
+  Bool enabled;
+  _Atomic Bool quit;
+  _Atomic ProgramStatus status;
+  Semaphore free;
+  Semaphore ready;
+  DisplayList* lists[SHELL_DISPLAY_LISTS];
+  AtomicQueueEvent events;
+  Event event_buffer[SHELL_EVENT_QUEUE];
+} ShellPipeline;
+
+static ShellPipeline shell_pipeline = {0};
+
 static KeyCode shell_key_table[VK_CARDINAL] = {
   [ VK_LBUTTON    ] = KEYCODE_MOUSE_LEFT,
   [ VK_RBUTTON    ] = KEYCODE_MOUSE_RIGHT,
@@ -176,9 +224,39 @@ static Bool shell_audio_acquire_buffer(AudioBuffer* out, const AudioDevice* devi
   }
 }
 
-static DWORD WINAPI shell_audio_entry(Void* data)
+static Void shell_audio_lock_memory()
+{
+  // The stack grows down and is committed lazily. This buffer extends the
+  // stack SHELL_AUDIO_STACK_LOCK bytes below our caller's frame, and the
+  // compiler's stack probe faults in each page of it. We then lock from the
+  // bottom of the buffer up to the stack base. The callbacks run later from
+  // our caller, and their frames grow down into these same pages, so they
+  // don't fault as long as they stay within that depth.
+  volatile Byte probe[SHELL_AUDIO_STACK_LOCK];
+  probe[0] = 0;
+
+  ULONG_PTR low = 0;
+  ULONG_PTR high = 0;
+  GetCurrentThreadStackLimits(&low, &high);
+  const ULONG_PTR page = platform_page_size();
+  const ULONG_PTR bottom = (ULONG_PTR) probe & ~(page - 1);
+  const Bool stack_status = platform_memory_lock((Void*) bottom, high - bottom);
+  if (stack_status == false) {
+    platform_log_warn("failed to lock audio thread stack");
+  }
+
+  // the scratch arena was committed in full when it was created
+  Arena* const arena = &shell_audio_scratch;
+  const Index scratch = MIN(SHELL_AUDIO_SCRATCH_LOCK, arena->committed);
+  const Bool scratch_status = platform_memory_lock(arena->base, (Size) scratch);
+  if (scratch_status == false) {
+    platform_log_warn("failed to lock audio scratch memory");
+  }
+}
+
+static Void shell_audio_entry(Void* data)
 {
-  UNUSED_PARAMETER(data);
+  const ProgramConfig* const config = data;
   HRESULT hr;
   IMMDeviceEnumerator* enumerator = NULL;
   AudioDevice device = {0};
@@ -189,12 +267,6 @@ static DWORD WINAPI shell_audio_entry(Void* data)
     goto cleanup;
   }
 
-  DWORD task_index = 0;
-  const HANDLE task_handle = AvSetMmThreadCharacteristicsA("Pro Audio", &task_index);
-  if (task_handle == 0) {
-    platform_log_warn("failed to set pro audio thread characteristic");
-  }
-
   hr = CoCreateInstance(&CLSID_MMDeviceEnumerator, NULL, CLSCTX_ALL, &IID_IMMDeviceEnumerator, &enumerator);
   if (FAILED(hr)) {
     platform_log_error("failed to create audio device enumerator");
@@ -280,6 +352,10 @@ static DWORD WINAPI shell_audio_entry(Void* data)
     goto cleanup;
   }
 
+  if (config->lock_audio_memory) {
+    shell_audio_lock_memory();
+  }
+
   hr = IAudioClient_Start(device.client);
   if (FAILED(hr)) {
     platform_log_error("failed to start audio client");
@@ -293,6 +369,7 @@ static DWORD WINAPI shell_audio_entry(Void* data)
     const Bool failed = shell_audio_acquire_buffer(&buffer, &device);
 
     if (failed == false) {
+      arena_reset(&shell_audio_scratch);
       status = loop_audio(buffer.data, buffer.frames);
       IAudioRenderClient_ReleaseBuffer(device.render, (U32) buffer.frames, 0);
     } else {
@@ -323,12 +400,25 @@ cleanup:
   if (enumerator) {
     IMMDeviceEnumerator_Release(enumerator);
   }
-  return THREAD_EXIT_SUCCESS;
 
 }
 
 #endif
 
+/*******************************************************************************
+ * SCRATCH MEMORY
+ ******************************************************************************/
+
+Arena* platform_video_scratch()
+{
+  return &shell_video_scratch;
+}
+
+Arena* platform_audio_scratch()
+{
+  return &shell_audio_scratch;
+}
+
 /*******************************************************************************
  * WINDOW MANAGEMENT
  ******************************************************************************/
@@ -342,6 +432,102 @@ V2S read_cursor()
   return out;
 }
 
+/*******************************************************************************
+ * PIPELINED RENDERING
+ ******************************************************************************/
+
+// Delivers window events to the program, on whichever thread runs it.
+static Void shell_post_event(const Event* event)
+{
+  if (shell_pipeline.enabled) {
+    const Bool queued = atomic_queue_enqueue_Event(&shell_pipeline.events, *event);
+    if (queued == false) {
+      platform_log_warn("dropped event, simulation thread is behind");
+    }
+  } else {
+    loop_event(event);
+  }
+}
+
+static Void shell_simulation_entry(Void* data)
+{
+  ShellPipeline* const pipeline = data;
+  job_attach();
+
+  for (Index frame = 0; ; frame++) {
+
+    semaphore_wait(&pipeline->free);
+    if (atomic_load_explicit(&pipeline->quit, memory_order_acquire)) {
+      break;
+    }
+
+    Event event;
+    while (atomic_queue_dequeue_many_Event(&pipeline->events, &event, 1)) {
+      loop_event(&event);
+    }
+
+    DisplayList* const list = pipeline->lists[frame % SHELL_DISPLAY_LISTS];
+    arena_reset(&shell_video_scratch);
+    display_record(list);
+    const ProgramStatus status = loop_video();
+    display_record(NULL);
+
+    atomic_store_explicit(&pipeline->status, status, memory_order_release);
+    semaphore_post(&pipeline->ready, 1);
+    if (status != PROGRAM_STATUS_LIVE) {
+      break;
+    }
+
+  }
+  job_detach();
+}
+
+static Bool shell_pipeline_start(ShellPipeline* pipeline)
+{
+  for (S32 i = 0; i < SHELL_DISPLAY_LISTS; i++) {
+    pipeline->lists[i] = display_list_create();
+    if (pipeline->lists[i] == NULL) {
+      for (S32 j = 0; j < i; j++) {
+        display_list_destroy(pipeline->lists[j]);
+        pipeline->lists[j] = NULL;
+      }
+      return false;
+    }
+  }
+  atomic_queue_init_Event(&pipeline->events, pipeline->event_buffer, SHELL_EVENT_QUEUE);
+  atomic_init(&pipeline->quit, false);
+  atomic_init(&pipeline->status, PROGRAM_STATUS_LIVE);
+  semaphore_init(&pipeline->free, SHELL_DISPLAY_LISTS);
+  semaphore_init(&pipeline->ready, 0);
+  pipeline->enabled = true;
+  return true;
+}
+
+// Returns event delivery to the main thread and frees the lists.
+static Void shell_pipeline_release(ShellPipeline* pipeline)
+{
+  pipeline->enabled = false;
+  for (S32 i = 0; i < SHELL_DISPLAY_LISTS; i++) {
+    display_list_destroy(pipeline->lists[i]);
+    pipeline->lists[i] = NULL;
+  }
+}
+
+static Void shell_pipeline_stop(ShellPipeline* pipeline, Thread* thread)
+{
+  // Every list is posted free so the simulation thread can't be stuck
+  // waiting for one, whatever it was doing when we stopped submitting.
+  atomic_store_explicit(&pipeline->quit, true, memory_order_release);
+  semaphore_post(&pipeline->free, SHELL_DISPLAY_LISTS);
+  platform_thread_join(thread);
+  job_attach();
+  shell_pipeline_release(pipeline);
+}
+
+/*******************************************************************************
+ * WINDOW MESSAGES
+ ******************************************************************************/
+
 static LRESULT CALLBACK wnd_proc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam)
 {
 
@@ -362,7 +548,7 @@ static LRESULT CALLBACK wnd_proc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lpar
 #endif
         if (kc != KEYCODE_NONE) {
           const Event event = key_event(KEYSTATE_DOWN, kc);
-          loop_event(&event);
+          shell_post_event(&event);
         }
       } break;
 
@@ -372,38 +558,38 @@ static LRESULT CALLBACK wnd_proc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lpar
         const KeyCode kc  = shell_key_table[vkcode];
         if (kc != KEYCODE_NONE) {
           const Event event = key_event(KEYSTATE_UP, kc);
-          loop_event(&event);
+          shell_post_event(&event);
         }
       } break;
 
     case WM_CHAR:
       {
         const Event event = character_event((Char) wparam);
-        loop_event(&event);
+        shell_post_event(&event);
       } break;
 
     case WM_LBUTTONDOWN:
       {
         const Event event = key_event(KEYSTATE_DOWN, KEYCODE_MOUSE_LEFT);
-        loop_event(&event);
+        shell_post_event(&event);
       } break;
 
     case WM_LBUTTONUP:
       {
         const Event event = key_event(KEYSTATE_UP, KEYCODE_MOUSE_LEFT);
-        loop_event(&event);
+        shell_post_event(&event);
       } break;
 
     case WM_RBUTTONDOWN:
       {
         const Event event = key_event(KEYSTATE_DOWN, KEYCODE_MOUSE_RIGHT);
-        loop_event(&event);
+        shell_post_event(&event);
       } break;
 
     case WM_RBUTTONUP:
       {
         const Event event = key_event(KEYSTATE_UP, KEYCODE_MOUSE_RIGHT);
-        loop_event(&event);
+        shell_post_event(&event);
       } break;
 
     case WM_MOUSEMOVE:
@@ -411,7 +597,7 @@ static LRESULT CALLBACK wnd_proc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lpar
         const S32 x = GET_X_LPARAM(lparam);
         const S32 y = GET_Y_LPARAM(lparam);
         const Event event = mouse_move_event(v2s(x, y));
-        loop_event(&event);
+        shell_post_event(&event);
       } break;
 
     default:
@@ -451,6 +637,21 @@ INT WINAPI WinMain(HINSTANCE instance, HINSTANCE prev_instance, PSTR cmdline, IN
     return shell_exit_code(config_status);
   }
 
+  // reserve scratch memory before any other program code runs
+  const Index video_scratch = config.video_scratch ? config.video_scratch : SHELL_VIDEO_SCRATCH;
+  arena_init_tagged(&shell_video_scratch, video_scratch, MEMORY_TAG_SCRATCH);
+#ifdef PLATFORM_AUDIO
+  const Index audio_scratch = config.audio_scratch ? config.audio_scratch : SHELL_AUDIO_SCRATCH;
+  arena_init_tagged(&shell_audio_scratch, audio_scratch, MEMORY_TAG_SCRATCH);
+  // Commit it all now, so allocations in loop_audio never call into the
+  // system from the real-time thread.
+  if (arena_commit(&shell_audio_scratch, audio_scratch) == false) {
+    platform_log_warn("failed to commit audio scratch memory");
+  }
+#endif
+
+  job_init(config.job_workers, config.job_affinity, config.job_fibers);
+
   if (config.normalize_working_directory) {
 
     // get executable file name
@@ -666,27 +867,40 @@ INT WINAPI WinMain(HINSTANCE instance, HINSTANCE prev_instance, PSTR cmdline, IN
 
 #ifdef PLATFORM_AUDIO
 
-  DWORD audio_thread_id = 0;
-  const HANDLE audio_thread = CreateThread( 
-      NULL,               // default security attributes
-      0,                  // default stack size
-      shell_audio_entry,  // entry point
-      NULL,
-      0,                  // default creation flags
-      &audio_thread_id    // receive thread identifier
-      );
+  const ThreadConfig audio_config = {
+    .name = "audio",
+    .affinity = config.audio_affinity,
+    .priority = THREAD_CLASS_AUDIO,
+  };
+  Thread* const audio_thread = platform_thread_create(shell_audio_entry, &config, &audio_config);
   if (audio_thread == NULL) {
     platform_log_error("failed to start audio thread");
-  } else {
-    const BOOL priority_status = SetThreadPriority(audio_thread, THREAD_PRIORITY_HIGHEST);
-    if (priority_status == FALSE) {
-      platform_log_warn("failed to set audio thread priority");
-    }
   }
 
 #endif
 
+  // Without a pipeline, the program renders unpipelined on this thread.
+  Thread* simulation_thread = NULL;
+  if (config.pipelined_rendering) {
+    const ThreadConfig simulation_config = { .name = "simulation" };
+    const Bool pipeline_status = shell_pipeline_start(&shell_pipeline);
+    if (pipeline_status == false) {
+      platform_log_warn("failed to allocate display lists, rendering unpipelined");
+    } else {
+      // the simulation thread takes over submitting jobs
+      job_detach();
+      simulation_thread = platform_thread_create(
+          shell_simulation_entry, &shell_pipeline, &simulation_config);
+      if (simulation_thread == NULL) {
+        platform_log_warn("failed to start simulation thread, rendering unpipelined");
+        job_attach();
+        shell_pipeline_release(&shell_pipeline);
+      }
+    }
+  }
+
   ProgramStatus status = PROGRAM_STATUS_LIVE;
+  Index frame = 0;
   Bool quit = false;
   while (quit == false && status == PROGRAM_STATUS_LIVE) {
 
@@ -699,26 +913,43 @@ INT WINAPI WinMain(HINSTANCE instance, HINSTANCE prev_instance, PSTR cmdline, IN
       DispatchMessage(&msg);
     }
 
-    if (quit == false) {
+    if (quit == false && simulation_thread) {
+      // submit frame N while the simulation thread records frame N + 1
+      semaphore_wait(&shell_pipeline.ready);
+      status = atomic_load_explicit(&shell_pipeline.status, memory_order_acquire);
+      display_submit(shell_pipeline.lists[frame % SHELL_DISPLAY_LISTS]);
+      semaphore_post(&shell_pipeline.free, 1);
+      SwapBuffers(hdc);
+      frame += 1;
+    } else if (quit == false) {
+      arena_reset(&shell_video_scratch);
       status = loop_video();
       SwapBuffers(hdc);
     }
 
   }
 
+  if (simulation_thread) {
+    shell_pipeline_stop(&shell_pipeline, simulation_thread);
+  }
+
   loop_terminate();
+  job_terminate();
 
 #ifdef PLATFORM_AUDIO
 
   // signal the audio thread and wait
   atomic_store(&quit_signal, true);
-  const DWORD wait_status = WaitForSingleObject(audio_thread, INFINITE);
-  if (wait_status != WAIT_OBJECT_0) {
-    platform_log_warn("unexpected wait status for audio thread");
+  if (audio_thread) {
+    platform_thread_join(audio_thread);
   }
 
+  arena_release(&shell_audio_scratch);
+
 #endif
 
+  arena_release(&shell_video_scratch);
+
   return SHELL_EXIT_SUCCESS;
 
 }
@@ -0,0 +1,21 @@
+#include "windows/wrapper.h"
+#include "sync.h"
+
+// WaitOnAddress compares the word in user mode before sleeping, and
+// Wake*ByAddress only calls into the kernel when a thread is waiting on the
+// address.
+
+Void platform_address_wait(_Atomic U32* address, U32 expected)
+{
+  WaitOnAddress((volatile Void*) address, &expected, sizeof(U32), INFINITE);
+}
+
+Void platform_address_wake_one(_Atomic U32* address)
+{
+  WakeByAddressSingle((Void*) address);
+}
+
+Void platform_address_wake_all(_Atomic U32* address)
+{
+  WakeByAddressAll((Void*) address);
+}
@@ -0,0 +1,133 @@
+#include "windows/wrapper.h"
+#include <avrt.h>
+#include <stdlib.h>
+#include "thread.h"
+#include "log.h"
+
+struct Thread {
+  HANDLE handle;
+  ThreadEntry* entry;
+  Void* data;
+  ThreadConfig config;
+};
+
+// MMCSS registration of the calling thread, if it has one
+static __declspec(thread) HANDLE thread_task = NULL;
+
+static Void thread_apply_config(const ThreadConfig* config)
+{
+  if (config->name && platform_thread_set_name(config->name) == false) {
+    platform_log_warn("failed to name thread %s", config->name);
+  }
+  if (config->affinity && platform_thread_set_affinity(config->affinity) == false) {
+    platform_log_warn("failed to set thread affinity");
+  }
+  if (config->priority != THREAD_CLASS_NORMAL && platform_thread_set_class(config->priority) == false) {
+    platform_log_warn("failed to set thread priority");
+  }
+}
+
+static DWORD WINAPI thread_trampoline(Void* parameter)
+{
+  Thread* const thread = parameter;
+  thread_apply_config(&thread->config);
+  thread->entry(thread->data);
+  platform_thread_set_class(THREAD_CLASS_NORMAL);
+  return 0;
+}
+
+Thread* platform_thread_create(ThreadEntry* entry, Void* data, const ThreadConfig* config)
+{
+  Thread* const thread = malloc(sizeof(Thread));
+  if (thread == NULL) {
+    return NULL;
+  }
+  thread->entry = entry;
+  thread->data = data;
+  thread->config = config ? *config : (ThreadConfig) {0};
+  thread->handle = CreateThread(NULL, 0, thread_trampoline, thread, 0, NULL);
+  if (thread->handle == NULL) {
+    platform_log_error("failed to create thread (%lu)", GetLastError());
+    free(thread);
+    return NULL;
+  }
+  return thread;
+}
+
+Void platform_thread_join(Thread* thread)
+{
+  const DWORD wait_status = WaitForSingleObject(thread->handle, INFINITE);
+  if (wait_status != WAIT_OBJECT_0) {
+    platform_log_warn("unexpected wait status for thread");
+  }
+  CloseHandle(thread->handle);
+  free(thread);
+}
+
+Void platform_thread_yield()
+{
+  SwitchToThread();
+}
+
+Bool platform_thread_set_name(const Char* name)
+{
+  WCHAR wide[64] = {0};
+  if (MultiByteToWideChar(CP_UTF8, 0, name, -1, wide, 63) == 0) {
+    return false;
+  }
+  return SUCCEEDED(SetThreadDescription(GetCurrentThread(), wide));
+}
+
+Bool platform_thread_set_affinity(CoreMask affinity)
+{
+  if (affinity == 0) {
+    return true;
+  }
+  return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) affinity) != 0;
+}
+
+Bool platform_thread_set_class(ThreadClass priority)
+{
+  static const S32 priority_table[THREAD_CLASS_CARDINAL] = {
+    [ THREAD_CLASS_NORMAL       ] = THREAD_PRIORITY_NORMAL,
+    [ THREAD_CLASS_BACKGROUND   ] = THREAD_PRIORITY_LOWEST,
+    [ THREAD_CLASS_HIGH         ] = THREAD_PRIORITY_HIGHEST,
+    [ THREAD_CLASS_AUDIO        ] = THREAD_PRIORITY_HIGHEST,
+  };
+  ASSERT(priority >= 0 && priority < THREAD_CLASS_CARDINAL);
+
+  if (thread_task && priority != THREAD_CLASS_AUDIO) {
+    AvRevertMmThreadCharacteristics(thread_task);
+    thread_task = NULL;
+  }
+
+  Bool status = true;
+  if (priority == THREAD_CLASS_AUDIO && thread_task == NULL) {
+    // MMCSS raises the thread into the real-time range while it is
+    // registered, and keeps it there despite CPU-heavy processes.
+    DWORD task_index = 0;
+    thread_task = AvSetMmThreadCharacteristicsA("Pro Audio", &task_index);
+    if (thread_task == NULL) {
+      platform_log_warn("failed to set pro audio thread characteristic");
+      status = false;
+    }
+  }
+
+  if (SetThreadPriority(GetCurrentThread(), priority_table[priority]) == FALSE) {
+    status = false;
+  }
+  return status;
+}
+
+S32 platform_thread_current_core()
+{
+  PROCESSOR_NUMBER number = {0};
+  GetCurrentProcessorNumberEx(&number);
+  return number.Group * 64 + number.Number;
+}
+
+S32 platform_core_count()
+{
+  const DWORD count = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+  return count > 0 ? (S32) count : 1;
+}